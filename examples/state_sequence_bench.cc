@@ -0,0 +1,208 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Benchmark of the native pipeline behind StateSequenceVisualization on synthetic data.
+//  For every combination of the given category counts, sequences per category, states per
+//  sequence and alphabet sizes, a deterministic CSV is generated in memory and we time:
+//    parse      single-threaded CSV parse (StateSequenceDataset::LoadCSVText)
+//    parse_mt   multithreaded CSV parse (StateSequenceParallelCSVLoader)
+//    domains    recomputing every category's domain from the columns
+//    layout     interval index plus layout (states or level-of-detail runs) of every category
+//    binary     serialization to the binary cache format
+//    svg        serialization of every category as SVG
+//  Times are the best of -r repeats, in seconds. Each combination runs in its own process, so the
+//  reported peak resident memory (which includes the generated CSV text) belongs to it alone.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../source/StateSequenceBinary.h"
+#include "../source/StateSequenceDataset.h"
+#include "../source/StateSequenceGenerator.h"
+#include "../source/StateSequenceIntervalIndex.h"
+#include "../source/StateSequenceParallelCSV.h"
+#include "../source/StateSequenceRenderer.h"
+
+using Dataset = emp::StateSequenceDataset;
+
+/// Parse a comma-separated list of positive integers.
+bool ParseList(const std::string & str, emp::vector<size_t> & out) {
+  out.clear();
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    const long value = std::atol(item.c_str());
+    if (value <= 0) return false;
+    out.push_back((size_t) value);
+  }
+  return !out.empty();
+}
+
+/// Best time (in seconds) of repeats calls to fun.
+template <typename FUN>
+double Time(size_t repeats, FUN fun) {
+  double best = -1.0;
+  for (size_t r = 0; r < repeats; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    fun();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (best < 0.0 || elapsed.count() < best) best = elapsed.count();
+  }
+  return best;
+}
+
+/// Domains of every category, computed from the columns alone.
+emp::vector<Dataset::Domain> ComputeDomains(const Dataset & data) {
+  emp::vector<Dataset::Domain> domains(data.GetNumCategories());
+  emp::vector<bool> seen(data.GetNumCategories(), false);
+  const auto & begins = data.GetSequenceBegins();
+  const auto & lengths = data.GetSequenceLengths();
+  const auto & categories = data.GetSequenceCategories();
+  const auto & starts = data.GetStarts();
+  const auto & durations = data.GetDurations();
+  for (size_t seq = 0; seq < data.GetNumSequences(); ++seq) {
+    Dataset::Domain & domain = domains[(size_t) categories[seq]];
+    domain.x_max += 1;
+    for (size_t k = begins[seq]; k < begins[seq] + lengths[seq]; ++k) {
+      const double end = starts[k] + durations[k];
+      if (!seen[(size_t) categories[seq]]) {
+        domain.y_min = starts[k];
+        domain.y_max = end;
+        seen[(size_t) categories[seq]] = true;
+      }
+      domain.y_min = std::min(domain.y_min, starts[k]);
+      domain.y_max = std::max(domain.y_max, end);
+    }
+  }
+  return domains;
+}
+
+/// Run the benchmark for one configuration and print its row. Returns false on failure.
+bool RunConfig(const emp::StateSequenceGenerator::Config & config, size_t num_threads, size_t repeats) {
+  const Dataset::Schema schema("states", "starts", "durations", "category", "seqID", "-");
+  emp::StateSequenceGenerator generator(config);
+  std::ostringstream csv_stream;
+  generator.Write(csv_stream, schema);
+  const std::string csv = csv_stream.str();
+
+  Dataset data;
+  bool ok = true;
+  const double parse_time = Time(repeats, [&]() { ok = data.LoadCSVText(csv.data(), csv.size(), schema) && ok; });
+  emp::StateSequenceParallelCSVLoader loader(num_threads);
+  const double parse_mt_time = Time(repeats, [&]() { ok = loader.Load(csv.data(), csv.size(), schema, data) && ok; });
+  if (!ok) {
+    std::cerr << "Failed to parse generated CSV: " << data.GetError() << loader.GetError() << std::endl;
+    return false;
+  }
+
+  emp::vector<Dataset::Domain> domains;
+  const double domain_time = Time(repeats, [&]() { domains = ComputeDomains(data); });
+  for (size_t cat = 0; cat < domains.size(); ++cat) {
+    if (!(domains[cat] == data.GetDomain((Dataset::code_t) cat))) {
+      std::cerr << "Recomputed domain of category " << cat << " does not match the dataset's." << std::endl;
+      return false;
+    }
+  }
+
+  emp::StateSequenceRenderer renderer;
+  size_t num_rects = 0;
+  const double layout_time = Time(repeats, [&]() {
+    emp::StateSequenceIntervalIndex index;
+    index.Update(data);
+    num_rects = 0;
+    for (size_t cat = 0; cat < data.GetNumCategories(); ++cat) {
+      renderer.Layout(data, (Dataset::code_t) cat, &index);
+      num_rects += renderer.GetNumRects();
+    }
+  });
+
+  const double binary_time = Time(repeats, [&]() {
+    std::ostringstream os;
+    emp::StateSequenceBinary::Write(data, os);
+  });
+  size_t svg_size = 0;
+  const double svg_time = Time(repeats, [&]() {
+    svg_size = 0;
+    for (size_t cat = 0; cat < data.GetNumCategories(); ++cat) {
+      std::ostringstream os;
+      renderer.RenderSVG(data, (Dataset::code_t) cat, os);
+      svg_size += (size_t) os.tellp();
+    }
+  });
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  const double mb = 1024.0 * 1024.0;
+  char row[512];
+  std::snprintf(row, sizeof(row),
+                "%6zu %8zu %6zu %5zu %10zu %8.1f %8.4f %8.4f %8.4f %8.4f %8.4f %8.4f %8zu %8.1f %8.1f %8.1f\n",
+                config.num_categories, config.sequences_per_category, config.states_per_sequence,
+                config.alphabet_size, data.GetNumStates(), (double) csv.size() / mb,
+                parse_time, parse_mt_time, domain_time, layout_time, binary_time, svg_time,
+                num_rects, (double) svg_size / mb, (double) data.GetMemoryUsage() / mb,
+                (double) usage.ru_maxrss / 1024.0);
+  std::cout << row << std::flush;
+  return true;
+}
+
+int main(int argc, char * argv[])
+{
+  size_t num_threads = 0;
+  size_t repeats = 3;
+  emp::vector<size_t> categories = { 4 };
+  emp::vector<size_t> sequences = { 1000, 10000 };
+  emp::vector<size_t> lengths = { 10, 100 };
+  emp::vector<size_t> alphabets = { 20 };
+  uint32_t seed = 1;
+  bool ok = true;
+  int arg = 1;
+  for (; ok && arg + 1 < argc && argv[arg][0] == '-'; ++arg) {
+    const std::string flag = argv[arg];
+    const std::string value = argv[++arg];
+    if (flag == "-j") num_threads = (size_t) std::atol(value.c_str());
+    else if (flag == "-r") repeats = std::max<size_t>(1, (size_t) std::atol(value.c_str()));
+    else if (flag == "-c") ok = ParseList(value, categories);
+    else if (flag == "-n") ok = ParseList(value, sequences);
+    else if (flag == "-s") ok = ParseList(value, lengths);
+    else if (flag == "-a") ok = ParseList(value, alphabets);
+    else if (flag == "--seed") seed = (uint32_t) std::strtoul(value.c_str(), nullptr, 10);
+    else ok = false;
+  }
+  if (!ok || arg != argc) {
+    std::cerr << "Usage: " << argv[0] << " [-j threads] [-r repeats] [-c categories,...] [-n sequences_per_category,...]"
+              << " [-s states_per_sequence,...] [-a alphabet_size,...] [--seed seed]" << std::endl;
+    return 1;
+  }
+
+  std::cout << "  cats  seqs/cat states alpha     states   csv_MB    parse parse_mt  domains   layout"
+            << "   binary      svg    rects   svg_MB  data_MB  peak_MB" << std::endl;
+  int failures = 0;
+  for (size_t c : categories) {
+    for (size_t n : sequences) {
+      for (size_t s : lengths) {
+        for (size_t a : alphabets) {
+          const emp::StateSequenceGenerator::Config config(c, n, s, a, 100, seed);
+          const pid_t pid = fork();
+          if (pid == 0) _exit(RunConfig(config, num_threads, repeats) ? 0 : 1);
+          int status = 0;
+          if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "Benchmark failed for " << c << " categories, " << n << " sequences, "
+                      << s << " states, alphabet " << a << std::endl;
+            ++failures;
+          }
+        }
+      }
+    }
+  }
+  return failures ? 1 : 0;
+}
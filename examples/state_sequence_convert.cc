@@ -0,0 +1,39 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Convert a state sequence CSV (plain, or gzip/zstd-compressed) into the binary cache format read by
+//  StateSequenceVisualization::LoadDataFromBinary.
+
+#include <iostream>
+#include <string>
+
+#include "../source/StateSequenceCSVStream.h"
+#include "../source/StateSequenceDataset.h"
+#include "../source/StateSequenceBinary.h"
+
+int main(int argc, char * argv[])
+{
+  if (argc != 3 && argc != 9) {
+    std::cerr << "Usage: " << argv[0] << " in.csv out.ssb [states starts durations category seqID delim]" << std::endl;
+    return 1;
+  }
+
+  emp::StateSequenceDataset::Schema schema("lineage_coded_phenotype_sequence",
+                                           "lineage_coded_start_updates", "lineage_coded_duration_updates",
+                                           "treatment", "replicate", "-");
+  if (argc == 9) schema = emp::StateSequenceDataset::Schema(argv[3], argv[4], argv[5], argv[6], argv[7], argv[8]);
+
+  emp::StateSequenceDataset data;
+  emp::StateSequenceCSVStream csv(schema);
+  if (!csv.LoadFile(data, argv[1])) {
+    std::cerr << "Failed to load " << argv[1] << ": " << csv.GetError() << std::endl;
+    return 1;
+  }
+  if (!emp::StateSequenceBinary::Write(data, argv[2])) {
+    std::cerr << "Failed to write " << argv[2] << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << data.GetNumSequences() << " sequences (" << data.GetNumStates()
+            << " states, " << data.GetNumCategories() << " categories) to " << argv[2] << std::endl;
+}
@@ -0,0 +1,56 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Write a deterministic synthetic state sequence CSV (same seed and settings, same file).
+//  With -r, sequence IDs repeat every id_period sequences of a category (to test duplicate IDs).
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../source/StateSequenceDataset.h"
+#include "../source/StateSequenceGenerator.h"
+
+int main(int argc, char * argv[])
+{
+  emp::StateSequenceGenerator::Config config;
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+    const std::string flag = argv[arg];
+    if (arg + 1 >= argc) break;
+    if (flag == "-c") config.num_categories = (size_t) std::atol(argv[++arg]);
+    else if (flag == "-n") config.sequences_per_category = (size_t) std::atol(argv[++arg]);
+    else if (flag == "-s") config.states_per_sequence = (size_t) std::atol(argv[++arg]);
+    else if (flag == "-a") config.alphabet_size = (size_t) std::atol(argv[++arg]);
+    else if (flag == "-m") config.max_duration = (size_t) std::atol(argv[++arg]);
+    else if (flag == "-r") config.id_period = (size_t) std::atol(argv[++arg]);
+    else if (flag == "--seed") config.seed = (uint32_t) std::strtoul(argv[++arg], nullptr, 10);
+    else break;
+  }
+  const int num_args = argc - arg;
+  if ((num_args != 1 && num_args != 7) || config.states_per_sequence == 0
+      || config.alphabet_size == 0 || config.max_duration == 0) {
+    std::cerr << "Usage: " << argv[0] << " [-c categories] [-n sequences_per_category] [-s states_per_sequence]"
+              << " [-a alphabet_size] [-m max_duration] [-r id_period] [--seed seed] out.csv"
+              << " [states starts durations category seqID delim]" << std::endl;
+    return 1;
+  }
+  const std::string out_file = argv[arg];
+
+  emp::StateSequenceDataset::Schema schema("lineage_coded_phenotype_sequence",
+                                           "lineage_coded_start_updates", "lineage_coded_duration_updates",
+                                           "treatment", "replicate", "-");
+  if (num_args == 7) {
+    schema = emp::StateSequenceDataset::Schema(argv[arg+1], argv[arg+2], argv[arg+3],
+                                               argv[arg+4], argv[arg+5], argv[arg+6]);
+  }
+
+  emp::StateSequenceGenerator generator(config);
+  if (!generator.Write(out_file, schema)) {
+    std::cerr << "Failed to write " << out_file << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << config.num_categories * config.sequences_per_category << " sequences ("
+            << generator.GetNumStates() << " states) to " << out_file << std::endl;
+}
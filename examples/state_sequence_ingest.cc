@@ -0,0 +1,154 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Multithreaded ingest of (very large) state sequence CSVs into the binary cache format.
+//  Compressed (gzip/zstd) CSVs are decompressed and parsed as a stream.
+//  With --check, the result is compared against a single-threaded parse of the plain text, as are
+//  parses split into many tiny chunks on several thread counts (so that chunk merging is exercised
+//  even on small inputs). The plain text is in.csv decompressed up front, or, with --reference
+//  plain.csv, that file (so that compressed input is checked against text the decompressor never saw).
+//  With --stats prefix, per-category statistics (see StateSequenceStatistics) of the parsed data are
+//  written to prefix_states.csv (stays, occupancy and mean dwell time per state) and
+//  prefix_transitions.csv (transition counts), using the same threads.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "../source/StateSequenceBinary.h"
+#include "../source/StateSequenceDataset.h"
+#include "../source/StateSequenceDecompressor.h"
+#include "../source/StateSequenceParallelCSV.h"
+#include "../source/StateSequenceStatistics.h"
+
+int main(int argc, char * argv[])
+{
+  size_t num_threads = 0;
+  bool check = false;
+  std::string reference_file;
+  std::string stats_prefix;
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+    const std::string flag = argv[arg];
+    if (flag == "-j" && arg + 1 < argc) num_threads = (size_t) std::atoi(argv[++arg]);
+    else if (flag == "--check") check = true;
+    else if (flag == "--reference" && arg + 1 < argc) reference_file = argv[++arg];
+    else if (flag == "--stats" && arg + 1 < argc) stats_prefix = argv[++arg];
+    else break;
+  }
+  const int num_args = argc - arg;
+  if (num_args != 2 && num_args != 8) {
+    std::cerr << "Usage: " << argv[0] << " [-j threads] [--check [--reference plain.csv]] [--stats prefix] in.csv out.ssb"
+              << " [states starts durations category seqID delim]" << std::endl;
+    return 1;
+  }
+  const std::string in_file = argv[arg];
+  const std::string out_file = argv[arg+1];
+
+  emp::StateSequenceDataset::Schema schema("lineage_coded_phenotype_sequence",
+                                           "lineage_coded_start_updates", "lineage_coded_duration_updates",
+                                           "treatment", "replicate", "-");
+  if (num_args == 8) {
+    schema = emp::StateSequenceDataset::Schema(argv[arg+2], argv[arg+3], argv[arg+4],
+                                               argv[arg+5], argv[arg+6], argv[arg+7]);
+  }
+
+  emp::StateSequenceParallelCSVLoader loader(num_threads);
+  emp::StateSequenceDataset data;
+  auto start_time = std::chrono::steady_clock::now();
+  if (!loader.Load(in_file, schema, data)) {
+    std::cerr << "Failed to load " << in_file << ": " << loader.GetError() << std::endl;
+    return 1;
+  }
+  const std::chrono::duration<double> parse_time = std::chrono::steady_clock::now() - start_time;
+  std::cout << "Parsed " << data.GetNumSequences() << " sequences (" << data.GetNumStates() << " states, "
+            << data.GetNumCategories() << " categories) on " << loader.GetNumThreads() << " threads in "
+            << parse_time.count() << "s" << std::endl;
+
+  if (check) {
+    // Compressed input is decompressed up front (all at once), then parsed like any plain text.
+    std::ifstream file(in_file, std::ios::binary);
+    const std::string raw((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::string text;
+    emp::StateSequenceDecompressor decompressor;
+    auto append = [&text](const char * piece, size_t size) { text.append(piece, size); return true; };
+    if (!decompressor.Feed(raw.data(), raw.size(), append) || !decompressor.Finish(append)) {
+      std::cerr << "Decompression failed: " << decompressor.GetError() << std::endl;
+      return 1;
+    }
+    if (!reference_file.empty()) {
+      std::ifstream reference(reference_file, std::ios::binary);
+      if (!reference.is_open()) {
+        std::cerr << "Unable to open reference " << reference_file << std::endl;
+        return 1;
+      }
+      text.assign(std::istreambuf_iterator<char>(reference), std::istreambuf_iterator<char>());
+    }
+    emp::StateSequenceDataset serial;
+    if (!serial.LoadCSVText(text.data(), text.size(), schema)) {
+      std::cerr << "Single-threaded load failed: " << serial.GetError() << std::endl;
+      return 1;
+    }
+    if (serial != data) {
+      std::cerr << "Mismatch between multithreaded and single-threaded parse!" << std::endl;
+      return 1;
+    }
+    for (size_t threads : { (size_t) 1, (size_t) 2, (size_t) 4, loader.GetNumThreads() }) {
+      // Chunks as small as a single record.
+      emp::StateSequenceParallelCSVLoader chunked_loader(threads, 1);
+      emp::StateSequenceDataset chunked;
+      if (!chunked_loader.Load(text.data(), text.size(), schema, chunked)) {
+        std::cerr << "Chunked load on " << threads << " threads failed: " << chunked_loader.GetError() << std::endl;
+        return 1;
+      }
+      if (serial != chunked) {
+        std::cerr << "Mismatch between chunked (" << threads << " threads) and single-threaded parse!" << std::endl;
+        return 1;
+      }
+    }
+    std::cout << "Matches single-threaded parse ("
+              << emp::StateSequenceDecompressor::GetFormatName(decompressor.GetFormat()) << " input"
+              << (reference_file.empty() ? "" : " against " + reference_file) << ")." << std::endl;
+  }
+
+  if (!stats_prefix.empty()) {
+    start_time = std::chrono::steady_clock::now();
+    emp::StateSequenceStatistics stats;
+    stats.Update(data, &loader.GetThreadPool());
+    const std::chrono::duration<double> stats_time = std::chrono::steady_clock::now() - start_time;
+    std::ofstream states_file(stats_prefix + "_states.csv");
+    std::ofstream transitions_file(stats_prefix + "_transitions.csv");
+    states_file << "category,state,visits,occupancy,mean_dwell\n";
+    transitions_file << "category,from,to,count\n";
+    const auto & names = data.GetStateNames();
+    for (size_t cat = 0; cat < data.GetNumCategories(); ++cat) {
+      const auto & summary = stats.Get(data, (emp::StateSequenceDataset::code_t) cat);
+      const std::string & category = data.GetCategories()[cat];
+      const size_t num_slots = summary.GetNumStates();
+      for (size_t s = 0; s < num_slots; ++s) {
+        const std::string & name = names[(size_t) summary.states[s]];
+        states_file << category << ',' << name << ',' << summary.visits[s] << ',' << summary.occupancy[s] << ','
+                    << summary.GetMeanDwell(summary.states[s]) << '\n';
+        for (size_t t = 0; t < num_slots; ++t) {
+          const uint64_t count = summary.transitions[s * num_slots + t];
+          if (count) transitions_file << category << ',' << name << ',' << names[(size_t) summary.states[t]] << ',' << count << '\n';
+        }
+      }
+    }
+    if (!states_file || !transitions_file) {
+      std::cerr << "Failed to write statistics to " << stats_prefix << "_*.csv" << std::endl;
+      return 1;
+    }
+    std::cout << "Computed statistics for " << data.GetNumCategories() << " categories in "
+              << stats_time.count() << "s" << std::endl;
+  }
+
+  if (!emp::StateSequenceBinary::Write(data, out_file)) {
+    std::cerr << "Failed to write " << out_file << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,109 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Render every category of a state sequence dataset (CSV or binary cache) to SVG and/or PNG,
+//  without a browser. Categories are rendered in parallel; category c goes to
+//  out_dir/<name>_<c>.svg (and .png), where <name> is the category name made file-name safe.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../source/StateSequenceBinary.h"
+#include "../source/StateSequenceDataset.h"
+#include "../source/StateSequenceParallelCSV.h"
+#include "../source/StateSequenceRenderer.h"
+#include "../source/ThreadPool.h"
+
+/// Turn a category name into something safe to use as a file name. Distinct categories can map to
+/// the same name (e.g., "a b" and "a/b"), so callers append the category code to keep paths apart.
+std::string FileName(const std::string & category) {
+  std::string name;
+  for (char c : category) {
+    const bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.';
+    name += safe ? c : '_';
+  }
+  return name.empty() ? "_" : name;
+}
+
+bool EndsWith(const std::string & str, const std::string & suffix) {
+  return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char * argv[])
+{
+  size_t num_threads = 0;
+  double width = 800.0;
+  double height = 500.0;
+  bool svg = false;
+  bool png = false;
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+    const std::string flag = argv[arg];
+    if (flag == "-j" && arg + 1 < argc) num_threads = (size_t) std::atoi(argv[++arg]);
+    else if (flag == "-W" && arg + 1 < argc) width = std::atof(argv[++arg]);
+    else if (flag == "-H" && arg + 1 < argc) height = std::atof(argv[++arg]);
+    else if (flag == "--svg") svg = true;
+    else if (flag == "--png") png = true;
+    else break;
+  }
+  const int num_args = argc - arg;
+  if (num_args != 2 && num_args != 8) {
+    std::cerr << "Usage: " << argv[0] << " [-j threads] [-W width] [-H height] [--svg] [--png] in.(csv|ssb) out_dir"
+              << " [states starts durations category seqID delim]" << std::endl;
+    return 1;
+  }
+  if (!svg && !png) svg = png = true;
+  const std::string in_file = argv[arg];
+  const std::string out_dir = argv[arg+1];
+
+  emp::StateSequenceDataset::Schema schema("lineage_coded_phenotype_sequence",
+                                           "lineage_coded_start_updates", "lineage_coded_duration_updates",
+                                           "treatment", "replicate", "-");
+  if (num_args == 8) {
+    schema = emp::StateSequenceDataset::Schema(argv[arg+2], argv[arg+3], argv[arg+4],
+                                               argv[arg+5], argv[arg+6], argv[arg+7]);
+  }
+
+  emp::StateSequenceDataset data;
+  std::string error;
+  bool loaded = false;
+  if (EndsWith(in_file, ".ssb")) {
+    loaded = emp::LoadStateSequenceBinary(in_file, data, error);
+  } else {
+    emp::StateSequenceParallelCSVLoader loader(num_threads);
+    loaded = loader.Load(in_file, schema, data);
+    error = loader.GetError();
+  }
+  if (!loaded) {
+    std::cerr << "Failed to load " << in_file << ": " << error << std::endl;
+    return 1;
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  emp::StateSequenceIntervalIndex index;
+  index.Update(data);
+  const auto & categories = data.GetCategories();
+  emp::vector<int> ok(categories.size(), 1);
+  emp::ThreadPool pool(num_threads);
+  pool.ParallelFor(categories.size(), [&](size_t cat) {
+    emp::StateSequenceRenderer renderer(width, height);
+    const std::string path = out_dir + "/" + FileName(categories[cat]) + "_" + std::to_string(cat);
+    const auto code = (emp::StateSequenceDataset::code_t) cat;
+    if (svg && !renderer.RenderSVG(data, code, path + ".svg", &index)) ok[cat] = 0;
+    if (png && !renderer.RenderImage(data, code, &index).WritePNG(path + ".png")) ok[cat] = 0;
+  });
+  const std::chrono::duration<double> render_time = std::chrono::steady_clock::now() - start_time;
+
+  int failures = 0;
+  for (size_t cat = 0; cat < categories.size(); ++cat) {
+    if (ok[cat]) continue;
+    std::cerr << "Failed to write output for category " << categories[cat] << " in " << out_dir << std::endl;
+    ++failures;
+  }
+  std::cout << "Rendered " << categories.size() - (size_t) failures << " of " << categories.size()
+            << " categories on " << pool.GetNumThreads() << " threads in " << render_time.count() << "s" << std::endl;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,39 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+
+#include <iostream>
+#include <string>
+
+#include "../source/StateSequenceCSVStream.h"
+#include "../source/StateSequenceDataset.h"
+
+int main(int argc, char * argv[])
+{
+  if (argc != 2 && argc != 8) {
+    std::cerr << "Usage: " << argv[0] << " data.csv [states starts durations category seqID delim]" << std::endl;
+    return 1;
+  }
+
+  emp::StateSequenceDataset::Schema schema("lineage_coded_phenotype_sequence",
+                                           "lineage_coded_start_updates", "lineage_coded_duration_updates",
+                                           "treatment", "replicate", "-");
+  if (argc == 8) schema = emp::StateSequenceDataset::Schema(argv[2], argv[3], argv[4], argv[5], argv[6], argv[7]);
+
+  emp::StateSequenceDataset data;
+  emp::StateSequenceCSVStream csv(schema);
+  if (!csv.LoadFile(data, argv[1])) {
+    std::cerr << "Failed to load " << argv[1] << ": " << csv.GetError() << std::endl;
+    return 1;
+  }
+
+  std::cout << data.GetNumSequences() << " sequences, " << data.GetNumStates() << " states, "
+            << data.GetStateNames().size() << " distinct states, "
+            << data.GetMemoryUsage() << " bytes" << std::endl;
+  for (size_t cat = 0; cat < data.GetNumCategories(); ++cat) {
+    const auto & domain = data.GetDomain((emp::StateSequenceDataset::code_t) cat);
+    std::cout << "  " << data.GetCategories()[cat]
+              << ": x = [" << domain.x_min << ", " << domain.x_max << "]"
+              << ", y = [" << domain.y_min << ", " << domain.y_max << "]" << std::endl;
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+
+#ifndef __EMSCRIPTEN__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace emp {
+
+#ifndef __EMSCRIPTEN__
+/// Read-only memory mapping of a whole file.
+class MappedFile {
+protected:
+  void * data;
+  size_t size;
+
+public:
+  MappedFile() : data(nullptr), size(0) { ; }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile & operator=(const MappedFile &) = delete;
+  ~MappedFile() { Close(); }
+
+  bool Open(const std::string & filename) {
+    Close();
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) { close(fd); return false; }
+    void * mapped = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    data = mapped;
+    size = (size_t) info.st_size;
+    return true;
+  }
+
+  void Close() {
+    if (data != nullptr) munmap(data, size);
+    data = nullptr;
+    size = 0;
+  }
+
+  const void * GetData() const { return data; }
+  size_t GetSize() const { return size; }
+};
+#endif
+
+}
+
+#endif
@@ -0,0 +1,414 @@
+#ifndef STATE_SEQUENCE_BINARY_H
+#define STATE_SEQUENCE_BINARY_H
+
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <initializer_list>
+#include <ostream>
+#include <cstdint>
+#include <cstring>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+#include "MappedFile.h"
+#include "StateSequenceDataset.h"
+
+namespace emp {
+
+/// Compact, parse-free on-disk format for a StateSequenceDataset.
+///
+/// Layout (little-endian; every section starts on an 8-byte boundary):
+///   * Header
+///   * String dictionary: uint64 offsets[num_strings + 1] followed by the characters of all
+///     strings. State names come first, then categories, then sequence IDs.
+///   * Category table: one CategoryRecord per category (precomputed domain, range of
+///     sequences, range of unique sequence IDs).
+///   * Category sequence IDs: int32 unique sequence ID codes for each category.
+///   * Sequence columns: uint32 begins, uint32 lengths, int32 sequence ID codes.
+///   * State columns: float64 starts, float64 durations, int32 state codes.
+/// Sequences are stored grouped by category (in category order, file order within a category),
+/// so each category's sequences form one contiguous range.
+class StateSequenceBinary {
+public:
+  static constexpr uint32_t VERSION = 1;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    uint64_t num_states;
+    uint64_t num_sequences;
+    uint64_t num_categories;
+    uint64_t num_state_names;
+    uint64_t num_seqID_names;
+    uint64_t num_category_ids;
+    uint64_t strings_offset;
+    uint64_t categories_offset;
+    uint64_t category_ids_offset;
+    uint64_t seq_begins_offset;
+    uint64_t seq_lengths_offset;
+    uint64_t seq_ids_offset;
+    uint64_t starts_offset;
+    uint64_t durations_offset;
+    uint64_t states_offset;
+  };
+
+  struct CategoryRecord {
+    double x_min;
+    double x_max;
+    double y_min;
+    double y_max;
+    uint32_t seq_begin;   ///< First sequence in this category.
+    uint32_t seq_count;   ///< Number of sequences in this category.
+    uint32_t ids_begin;   ///< First entry of this category's unique sequence IDs.
+    uint32_t ids_count;   ///< Number of unique sequence IDs in this category.
+  };
+
+  static const char * Magic() { return "SSEQBIN"; }
+
+  static uint64_t Align(uint64_t offset) { return (offset + 7) & ~((uint64_t) 7); }
+
+protected:
+  template <typename T>
+  static void WriteArray(std::ostream & os, uint64_t & pos, const T * values, size_t count) {
+    const uint64_t aligned = Align(pos);
+    static const char padding[8] = { 0 };
+    os.write(padding, (std::streamsize) (aligned - pos));
+    os.write(reinterpret_cast<const char *>(values), (std::streamsize) (count * sizeof(T)));
+    pos = aligned + count * sizeof(T);
+  }
+
+public:
+  /// Write data to os in binary format. Returns false if the stream failed.
+  static bool Write(const StateSequenceDataset & data, std::ostream & os) {
+    using code_t = StateSequenceDataset::code_t;
+    using index_t = StateSequenceDataset::index_t;
+    const size_t num_cats = data.GetNumCategories();
+    const size_t num_seqs = data.GetNumSequences();
+
+    emp::vector<CategoryRecord> records(num_cats);
+    emp::vector<code_t> category_ids;
+    emp::vector<index_t> seq_begins, seq_lengths;
+    emp::vector<code_t> seq_ids;
+    emp::vector<double> starts, durations;
+    emp::vector<code_t> states;
+    seq_begins.reserve(num_seqs); seq_lengths.reserve(num_seqs); seq_ids.reserve(num_seqs);
+    starts.reserve(data.GetNumStates()); durations.reserve(data.GetNumStates()); states.reserve(data.GetNumStates());
+    for (size_t cat = 0; cat < num_cats; ++cat) {
+      const auto & domain = data.GetDomain((code_t) cat);
+      const auto & ids = data.GetCategorySequenceIDs((code_t) cat);
+      CategoryRecord & rec = records[cat];
+      rec.x_min = domain.x_min; rec.x_max = domain.x_max;
+      rec.y_min = domain.y_min; rec.y_max = domain.y_max;
+      rec.seq_begin = (uint32_t) seq_begins.size();
+      rec.seq_count = (uint32_t) data.GetCategorySequences((code_t) cat).size();
+      rec.ids_begin = (uint32_t) category_ids.size();
+      rec.ids_count = (uint32_t) ids.size();
+      category_ids.insert(category_ids.end(), ids.begin(), ids.end());
+      for (index_t s : data.GetCategorySequences((code_t) cat)) {
+        const index_t begin = data.GetSequenceBegins()[s];
+        const index_t length = data.GetSequenceLengths()[s];
+        seq_begins.push_back((index_t) states.size());
+        seq_lengths.push_back(length);
+        seq_ids.push_back(data.GetSequenceIDs()[s]);
+        starts.insert(starts.end(), data.GetStarts().begin() + begin, data.GetStarts().begin() + begin + length);
+        durations.insert(durations.end(), data.GetDurations().begin() + begin, data.GetDurations().begin() + begin + length);
+        states.insert(states.end(), data.GetStates().begin() + begin, data.GetStates().begin() + begin + length);
+      }
+    }
+
+    // String dictionary.
+    emp::vector<uint64_t> string_offsets(1, 0);
+    std::string chars;
+    for (const auto * dict : { &data.GetStateDictionary(), &data.GetCategoryDictionary(),
+                               &data.GetSequenceIDDictionary() }) {
+      for (const auto & name : dict->GetNames()) {
+        chars += name;
+        string_offsets.push_back(chars.size());
+      }
+    }
+
+    // Lay out sections.
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic(), 8);
+    header.version = VERSION;
+    header.header_size = sizeof(Header);
+    header.num_states = states.size();
+    header.num_sequences = num_seqs;
+    header.num_categories = num_cats;
+    header.num_state_names = data.GetStateDictionary().size();
+    header.num_seqID_names = data.GetSequenceIDDictionary().size();
+    header.num_category_ids = category_ids.size();
+    uint64_t pos = sizeof(Header);
+    header.strings_offset = pos = Align(pos);
+    pos += string_offsets.size() * sizeof(uint64_t) + chars.size();
+    header.categories_offset = pos = Align(pos);
+    pos += records.size() * sizeof(CategoryRecord);
+    header.category_ids_offset = pos = Align(pos);
+    pos += category_ids.size() * sizeof(code_t);
+    header.seq_begins_offset = pos = Align(pos);
+    pos += num_seqs * sizeof(index_t);
+    header.seq_lengths_offset = pos = Align(pos);
+    pos += num_seqs * sizeof(index_t);
+    header.seq_ids_offset = pos = Align(pos);
+    pos += num_seqs * sizeof(code_t);
+    header.starts_offset = pos = Align(pos);
+    pos += starts.size() * sizeof(double);
+    header.durations_offset = pos = Align(pos);
+    pos += durations.size() * sizeof(double);
+    header.states_offset = pos = Align(pos);
+    pos += states.size() * sizeof(code_t);
+    header.file_size = pos;
+
+    uint64_t written = 0;
+    WriteArray(os, written, &header, 1);
+    WriteArray(os, written, string_offsets.data(), string_offsets.size());
+    os.write(chars.data(), (std::streamsize) chars.size());
+    written += chars.size();
+    WriteArray(os, written, records.data(), records.size());
+    WriteArray(os, written, category_ids.data(), category_ids.size());
+    WriteArray(os, written, seq_begins.data(), seq_begins.size());
+    WriteArray(os, written, seq_lengths.data(), seq_lengths.size());
+    WriteArray(os, written, seq_ids.data(), seq_ids.size());
+    WriteArray(os, written, starts.data(), starts.size());
+    WriteArray(os, written, durations.data(), durations.size());
+    WriteArray(os, written, states.data(), states.size());
+    emp_assert(written == header.file_size, written, header.file_size);
+    return (bool) os;
+  }
+
+  /// Write data to the file filename in binary format.
+  static bool Write(const StateSequenceDataset & data, const std::string & filename) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+    return Write(data, file);
+  }
+};
+
+/// Read-only view of a binary state sequence buffer (e.g., a memory-mapped file or an
+/// ArrayBuffer copied into the heap). Nothing is copied or parsed; the buffer must outlive the view.
+class StateSequenceBinaryView {
+public:
+  using Header = StateSequenceBinary::Header;
+  using CategoryRecord = StateSequenceBinary::CategoryRecord;
+  using code_t = StateSequenceDataset::code_t;
+  using index_t = StateSequenceDataset::index_t;
+
+protected:
+  const unsigned char * buffer;
+  size_t size;
+  const Header * header;
+  std::string error;
+
+  template <typename T>
+  const T * Section(uint64_t offset) const { return reinterpret_cast<const T *>(buffer + offset); }
+
+  /// Check that [offset, offset + count * sizeof(T)) is an aligned range inside the buffer.
+  template <typename T>
+  bool CheckSection(uint64_t offset, uint64_t count, const char * name) {
+    if (offset % alignof(T) != 0 || offset > size || count > (size - offset) / sizeof(T)) {
+      error = std::string("Binary data section '") + name + "' is out of bounds.";
+      return false;
+    }
+    return true;
+  }
+
+public:
+  StateSequenceBinaryView() : buffer(nullptr), size(0), header(nullptr), error() { ; }
+
+  /// Point this view at a buffer holding binary state sequence data and validate its layout and codes.
+  bool Open(const void * _buffer, size_t _size) {
+    buffer = static_cast<const unsigned char *>(_buffer);
+    size = _size;
+    header = nullptr;
+    if (buffer == nullptr || size < sizeof(Header) || reinterpret_cast<uintptr_t>(buffer) % 8 != 0) {
+      error = "Binary data is truncated or misaligned.";
+      return false;
+    }
+    const Header * h = reinterpret_cast<const Header *>(buffer);
+    if (std::memcmp(h->magic, StateSequenceBinary::Magic(), 8) != 0) {
+      error = "Not a binary state sequence file.";
+      return false;
+    }
+    if (h->version != StateSequenceBinary::VERSION || h->header_size != sizeof(Header)) {
+      error = "Unsupported binary state sequence version " + std::to_string(h->version) + ".";
+      return false;
+    }
+    if (h->file_size > size) {
+      error = "Binary data is truncated.";
+      return false;
+    }
+    // Bound each dictionary count by the room left for offsets before adding them (so the sum can't wrap).
+    if (!CheckSection<uint64_t>(h->strings_offset, 0, "strings")) return false;
+    const uint64_t max_strings = (size - h->strings_offset) / sizeof(uint64_t);
+    if (h->num_state_names > max_strings || h->num_categories > max_strings || h->num_seqID_names > max_strings) {
+      error = "Binary data section 'strings' is out of bounds.";
+      return false;
+    }
+    const uint64_t num_strings = h->num_state_names + h->num_categories + h->num_seqID_names;
+    if (!CheckSection<uint64_t>(h->strings_offset, num_strings + 1, "strings")) return false;
+    const uint64_t chars_offset = h->strings_offset + (num_strings + 1) * sizeof(uint64_t);
+    const uint64_t num_chars = Section<uint64_t>(h->strings_offset)[num_strings];
+    if (!CheckSection<char>(chars_offset, num_chars, "string data")) return false;
+    if (!CheckSection<CategoryRecord>(h->categories_offset, h->num_categories, "categories")) return false;
+    if (!CheckSection<code_t>(h->category_ids_offset, h->num_category_ids, "category IDs")) return false;
+    if (!CheckSection<index_t>(h->seq_begins_offset, h->num_sequences, "sequence begins")) return false;
+    if (!CheckSection<index_t>(h->seq_lengths_offset, h->num_sequences, "sequence lengths")) return false;
+    if (!CheckSection<code_t>(h->seq_ids_offset, h->num_sequences, "sequence IDs")) return false;
+    if (!CheckSection<double>(h->starts_offset, h->num_states, "starts")) return false;
+    if (!CheckSection<double>(h->durations_offset, h->num_states, "durations")) return false;
+    if (!CheckSection<code_t>(h->states_offset, h->num_states, "states")) return false;
+    const uint64_t * offsets = Section<uint64_t>(h->strings_offset);
+    for (uint64_t i = 0; i < num_strings; ++i) {
+      if (offsets[i] > offsets[i+1]) { error = "Binary string table is corrupt."; return false; }
+    }
+    // Categories must cover the sequences in order, each with its own (distinct) sequence IDs.
+    // (id_owner is sized by num_seqID_names only now that the string table has bounded it.)
+    const CategoryRecord * cats = Section<CategoryRecord>(h->categories_offset);
+    const code_t * category_ids = Section<code_t>(h->category_ids_offset);
+    emp::vector<uint64_t> id_owner((size_t) h->num_seqID_names, h->num_categories);
+    uint64_t next_seq = 0;
+    for (uint64_t c = 0; c < h->num_categories; ++c) {
+      if (cats[c].seq_begin != next_seq || (uint64_t) cats[c].seq_begin + cats[c].seq_count > h->num_sequences
+          || (uint64_t) cats[c].ids_begin + cats[c].ids_count > h->num_category_ids) {
+        error = "Binary category table is corrupt.";
+        return false;
+      }
+      next_seq += cats[c].seq_count;
+      for (uint64_t i = cats[c].ids_begin; i < (uint64_t) cats[c].ids_begin + cats[c].ids_count; ++i) {
+        const code_t id = category_ids[i];
+        if (id < 0 || (uint64_t) id >= h->num_seqID_names || id_owner[(size_t) id] == c) {
+          error = "Binary category sequence IDs are corrupt.";
+          return false;
+        }
+        id_owner[(size_t) id] = c;
+      }
+    }
+    if (next_seq != h->num_sequences) {
+      error = "Binary category table is corrupt.";
+      return false;
+    }
+    const index_t * begins = Section<index_t>(h->seq_begins_offset);
+    const index_t * lengths = Section<index_t>(h->seq_lengths_offset);
+    const code_t * seq_ids = Section<code_t>(h->seq_ids_offset);
+    for (uint64_t s = 0; s < h->num_sequences; ++s) {
+      if ((uint64_t) begins[s] + lengths[s] > h->num_states
+          || seq_ids[s] < 0 || (uint64_t) seq_ids[s] >= h->num_seqID_names) {
+        error = "Binary sequence table is corrupt.";
+        return false;
+      }
+    }
+    const code_t * states = Section<code_t>(h->states_offset);
+    for (uint64_t k = 0; k < h->num_states; ++k) {
+      if (states[k] < 0 || (uint64_t) states[k] >= h->num_state_names) {
+        error = "Binary state codes are corrupt.";
+        return false;
+      }
+    }
+    header = h;
+    return true;
+  }
+
+  bool IsOpen() const { return header != nullptr; }
+  const std::string & GetError() const { return error; }
+
+  size_t GetNumStates() const { return (size_t) header->num_states; }
+  size_t GetNumSequences() const { return (size_t) header->num_sequences; }
+  size_t GetNumCategories() const { return (size_t) header->num_categories; }
+  size_t GetNumStateNames() const { return (size_t) header->num_state_names; }
+  size_t GetNumSequenceIDNames() const { return (size_t) header->num_seqID_names; }
+
+  /// Get string i of the dictionary (state names, then categories, then sequence IDs).
+  std::string GetString(size_t i) const {
+    const uint64_t num_strings = header->num_state_names + header->num_categories + header->num_seqID_names;
+    emp_assert(i < num_strings, i, num_strings);
+    const uint64_t * offsets = Section<uint64_t>(header->strings_offset);
+    const char * chars = Section<char>(header->strings_offset + (num_strings + 1) * sizeof(uint64_t));
+    return std::string(chars + offsets[i], chars + offsets[i+1]);
+  }
+  std::string GetStateName(size_t code) const { return GetString(code); }
+  std::string GetCategory(size_t code) const { return GetString(GetNumStateNames() + code); }
+  std::string GetSequenceIDName(size_t code) const {
+    return GetString(GetNumStateNames() + GetNumCategories() + code);
+  }
+
+  const CategoryRecord * GetCategoryRecords() const { return Section<CategoryRecord>(header->categories_offset); }
+  const code_t * GetCategorySequenceIDs() const { return Section<code_t>(header->category_ids_offset); }
+  const index_t * GetSequenceBegins() const { return Section<index_t>(header->seq_begins_offset); }
+  const index_t * GetSequenceLengths() const { return Section<index_t>(header->seq_lengths_offset); }
+  const code_t * GetSequenceIDs() const { return Section<code_t>(header->seq_ids_offset); }
+  const double * GetStarts() const { return Section<double>(header->starts_offset); }
+  const double * GetDurations() const { return Section<double>(header->durations_offset); }
+  const code_t * GetStates() const { return Section<code_t>(header->states_offset); }
+
+  /// Fill data with the contents of this view (bulk column copies; no per-field parsing).
+  bool ToDataset(StateSequenceDataset & data) const {
+    emp_assert(IsOpen());
+    data.Clear();
+    for (size_t i = 0; i < GetNumStateNames(); ++i) data.state_dict.Insert(GetStateName(i));
+    for (size_t i = 0; i < GetNumCategories(); ++i) data.category_dict.Insert(GetCategory(i));
+    for (size_t i = 0; i < GetNumSequenceIDNames(); ++i) data.seqID_dict.Insert(GetSequenceIDName(i));
+    if (data.state_dict.size() != GetNumStateNames() || data.category_dict.size() != GetNumCategories()
+        || data.seqID_dict.size() != GetNumSequenceIDNames()) {
+      data.Clear();
+      data.error = "Binary string dictionary contains duplicates.";
+      return false;
+    }
+
+    const size_t num_states = GetNumStates();
+    const size_t num_seqs = GetNumSequences();
+    data.states.assign(GetStates(), GetStates() + num_states);
+    data.starts.assign(GetStarts(), GetStarts() + num_states);
+    data.durations.assign(GetDurations(), GetDurations() + num_states);
+    data.seq_begins.assign(GetSequenceBegins(), GetSequenceBegins() + num_seqs);
+    data.seq_lengths.assign(GetSequenceLengths(), GetSequenceLengths() + num_seqs);
+    data.seq_ids.assign(GetSequenceIDs(), GetSequenceIDs() + num_seqs);
+    data.seq_categories.resize(num_seqs);
+
+    const CategoryRecord * records = GetCategoryRecords();
+    const code_t * ids = GetCategorySequenceIDs();
+    for (size_t cat = 0; cat < GetNumCategories(); ++cat) {
+      const CategoryRecord & rec = records[cat];
+      data.domains.emplace_back(rec.x_min, rec.x_max, rec.y_min, rec.y_max);
+      data.category_ids.emplace_back(ids + rec.ids_begin, ids + rec.ids_begin + rec.ids_count);
+      data.category_seqs.emplace_back(rec.seq_count);
+      for (uint32_t i = 0; i < rec.seq_count; ++i) data.category_seqs.back()[i] = rec.seq_begin + i;
+      for (uint32_t i = 0; i < rec.ids_count; ++i) {
+        data.category_id_set.insert(StateSequenceDataset::CategoryIDKey((code_t) cat, ids[rec.ids_begin + i]));
+      }
+      std::fill(data.seq_categories.begin() + rec.seq_begin,
+                data.seq_categories.begin() + rec.seq_begin + rec.seq_count, (code_t) cat);
+    }
+    return true;
+  }
+};
+
+#ifndef __EMSCRIPTEN__
+/// Memory-map a binary state sequence file and load it into data.
+inline bool LoadStateSequenceBinary(const std::string & filename, StateSequenceDataset & data,
+                                    std::string & error) {
+  MappedFile file;
+  if (!file.Open(filename)) {
+    error = "Unable to map file '" + filename + "'.";
+    return false;
+  }
+  StateSequenceBinaryView view;
+  if (!view.Open(file.GetData(), file.GetSize())) {
+    error = view.GetError();
+    return false;
+  }
+  if (!view.ToDataset(data)) {
+    error = data.GetError();
+    return false;
+  }
+  return true;
+}
+#endif
+
+}
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef STATE_SEQUENCE_CSV_STREAM_H
+#define STATE_SEQUENCE_CSV_STREAM_H
+
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+#include "StateSequenceDataset.h"
+#include "StateSequenceDecompressor.h"
+
+namespace emp {
+
+/// Incremental CSV parser: feed it arbitrary-sized chunks of a CSV file and every complete record
+/// is appended to a StateSequenceDataset as soon as it arrives. Only the trailing partial line of
+/// each chunk is buffered, so memory use is bounded by the chunk size plus the parsed columns.
+/// Compressed files (see StateSequenceDecompressor) are decompressed on the way in, a piece at a time.
+class StateSequenceCSVStream {
+protected:
+  StateSequenceDataset::CSVColumns cols;
+  StateSequenceDecompressor decompressor;
+  bool header_done;   ///< Has the header line been parsed?
+  bool failed;        ///< Has a parse error occurred? (Further input is ignored.)
+  size_t line_num;    ///< Number of lines consumed so far.
+  std::string carry;  ///< Partial line left over from the previous chunk.
+  std::string error;
+
+  bool ProcessLines(StateSequenceDataset & data, const char * begin, const char * end) {
+    if (begin == end) return true;
+    if (!header_done) {
+      const char * header_end = static_cast<const char *>(std::memchr(begin, '\n', (size_t) (end - begin)));
+      if (header_end == nullptr) header_end = end;
+      ++line_num;
+      if (!data.ParseCSVHeader(begin, header_end, cols)) return Fail(data);
+      header_done = true;
+      begin = (header_end == end) ? end : header_end + 1;
+      if (begin == end) return true;
+    }
+    if (!data.AppendCSVRecords(begin, end, cols, line_num + 1)) return Fail(data);
+    line_num += (size_t) std::count(begin, end, '\n') + (end[-1] == '\n' ? 0 : 1);
+    return true;
+  }
+
+  bool Fail(const StateSequenceDataset & data) {
+    failed = true;
+    error = data.GetError();
+    return false;
+  }
+
+  /// Record a failure of the decompressor (unless the parser failed first, and already said why).
+  bool Decompressed(bool ok) {
+    if (!ok && !failed) {
+      failed = true;
+      error = decompressor.GetError();
+    }
+    return ok;
+  }
+
+  /// Parse the next size bytes of (decompressed) CSV text into data.
+  bool FeedText(StateSequenceDataset & data, const char * chunk, size_t size) {
+    if (failed) return false;
+    const char * end = chunk + size;
+    const char * last_newline = nullptr;
+    for (const char * cur = end; cur > chunk; --cur) {
+      if (cur[-1] == '\n') { last_newline = cur - 1; break; }
+    }
+    if (last_newline == nullptr) {
+      carry.append(chunk, size);
+      return true;
+    }
+    const char * first_newline = static_cast<const char *>(std::memchr(chunk, '\n', size));
+    const char * begin = chunk;
+    if (!carry.empty()) {
+      // Complete the line carried over from the previous chunk.
+      carry.append(chunk, (size_t) (first_newline - chunk) + 1);
+      if (!ProcessLines(data, carry.data(), carry.data() + carry.size())) return false;
+      carry.clear();
+      begin = first_newline + 1;
+    }
+    if (!ProcessLines(data, begin, last_newline + 1)) return false;
+    carry.assign(last_newline + 1, end);
+    return true;
+  }
+
+public:
+  StateSequenceCSVStream(const StateSequenceDataset::Schema & schema=StateSequenceDataset::Schema())
+    : cols(schema), decompressor(), header_done(false), failed(false), line_num(0), carry(), error()
+  { ; }
+
+  /// Start a new stream described by schema. With extend, records for a sequence ID already in their
+  /// category extend that sequence (see StateSequenceDataset::ExtendSequence) instead of adding one.
+  void Reset(const StateSequenceDataset::Schema & schema, bool extend=false) {
+    cols = StateSequenceDataset::CSVColumns(schema, extend);
+    decompressor.Reset();
+    header_done = false;
+    failed = false;
+    line_num = 0;
+    carry.clear();
+    error.clear();
+  }
+
+  /// Start a new stream of more records (no header) laid out like those of other, which has read its
+  /// header. (E.g., rows appended to a file after it was loaded.)
+  void Continue(const StateSequenceCSVStream & other, bool extend=false) {
+    emp_assert(other.header_done);
+    Reset(other.cols.schema, extend);
+    cols = other.cols;
+    cols.extend = extend;
+    header_done = true;
+    line_num = other.line_num;
+  }
+
+  bool HasHeader() const { return header_done; }
+  bool HasFailed() const { return failed; }
+  const std::string & GetError() const { return error; }
+  size_t GetNumLines() const { return line_num; }
+
+  /// Format of the stream (known once its first bytes have been fed).
+  StateSequenceDecompressor::Format GetFormat() const { return decompressor.GetFormat(); }
+
+  /// Parse the next size bytes of the stream (CSV text, or compressed CSV text) into data.
+  bool Feed(StateSequenceDataset & data, const char * chunk, size_t size) {
+    if (failed) return false;
+    return Decompressed(decompressor.Feed(chunk, size, [this, &data](const char * text, size_t text_size) {
+      return this->FeedText(data, text, text_size);
+    }));
+  }
+
+  /// Signal the end of the stream (parses any final unterminated line).
+  bool Finish(StateSequenceDataset & data) {
+    if (failed) return false;
+    const bool flushed = decompressor.Finish([this, &data](const char * text, size_t text_size) {
+      return this->FeedText(data, text, text_size);
+    });
+    if (!Decompressed(flushed)) return false;
+    if (!ProcessLines(data, carry.data(), carry.data() + carry.size())) return false;
+    carry.clear();
+    if (!header_done) {
+      failed = true;
+      error = "CSV data is empty.";
+      return false;
+    }
+    return true;
+  }
+
+  /// Load the (possibly compressed) CSV file filename into data, replacing its contents, reading and
+  /// parsing chunk_size bytes at a time.
+  bool LoadFile(StateSequenceDataset & data, const std::string & filename, size_t chunk_size=(1 << 20)) {
+    Reset(cols.schema);
+    data.Clear();
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+      failed = true;
+      error = "Unable to open file '" + filename + "'.";
+      return false;
+    }
+    emp::vector<char> chunk(chunk_size);
+    while (file) {
+      file.read(chunk.data(), (std::streamsize) chunk.size());
+      if (file.gcount() > 0 && !Feed(data, chunk.data(), (size_t) file.gcount())) return false;
+    }
+    return Finish(data);
+  }
+};
+
+}
+
+#endif
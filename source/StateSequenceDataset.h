@@ -0,0 +1,600 @@
+#ifndef STATE_SEQUENCE_DATASET_H
+#define STATE_SEQUENCE_DATASET_H
+
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <istream>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+namespace emp {
+
+class StateSequenceBinaryView;
+class StateSequenceParallelCSVLoader;
+
+/// Native storage for state sequence data.
+/// Every state of every sequence lives in flat struct-of-arrays columns (state code, start,
+/// duration); sequences are ranges into those columns. State names, categories and sequence IDs
+/// are dictionary-encoded to integer codes (assigned in order of first appearance).
+class StateSequenceDataset {
+  friend class StateSequenceBinaryView;
+  friend class StateSequenceParallelCSVLoader;
+public:
+  using code_t = int32_t;    ///< Dictionary code for state names, categories and sequence IDs.
+  using index_t = uint32_t;  ///< Index into the per-state columns.
+
+  static constexpr index_t NO_SEQUENCE = (index_t) -1;  ///< Returned by FindSequence when nothing is found.
+
+  /// Extent of a category's data. Mirrors the x/y domains used by the visualization:
+  /// x spans [0, number of sequences], y spans [earliest start, latest end].
+  struct Domain {
+    double x_min;
+    double x_max;
+    double y_min;
+    double y_max;
+
+    Domain(double _x_min=0.0, double _x_max=0.0, double _y_min=0.0, double _y_max=0.0)
+      : x_min(_x_min), x_max(_x_max), y_min(_y_min), y_max(_y_max)
+    { ; }
+
+    bool operator==(const Domain & other) const {
+      return x_min == other.x_min && x_max == other.x_max
+          && y_min == other.y_min && y_max == other.y_max;
+    }
+  };
+
+  /// Describes where to find sequence information in a CSV file.
+  struct Schema {
+    std::string states;     ///< Column name that specifies state sequence.
+    std::string starts;     ///< Column name that specifies state start values.
+    std::string durations;  ///< Column name that specifies state duration values.
+    std::string category;   ///< Column name that specifies sequence category.
+    std::string seqID;      ///< Column name that specifies sequence ID within its category.
+    std::string delim;      ///< Delimiter used within state/start/duration columns.
+
+    Schema(const std::string & _states="", const std::string & _starts="",
+           const std::string & _durations="", const std::string & _category="",
+           const std::string & _seqID="", const std::string & _delim="-")
+      : states(_states), starts(_starts), durations(_durations), category(_category),
+        seqID(_seqID), delim(_delim)
+    { ; }
+  };
+
+  /// Information needed to turn CSV records into sequences.
+  struct CSVColumns {
+    Schema schema;
+    size_t states;
+    size_t starts;
+    size_t durations;
+    size_t category;
+    size_t seqID;
+    size_t num_columns;
+    bool extend;  ///< Do records for a sequence ID already in their category extend that sequence?
+
+    CSVColumns(const Schema & _schema, bool _extend=false)
+      : schema(_schema), states(0), starts(0), durations(0), category(0), seqID(0), num_columns(0),
+        extend(_extend)
+    { ; }
+  };
+
+  /// Bidirectional mapping between strings and dense integer codes.
+  class Dictionary {
+  protected:
+    emp::vector<std::string> names;
+    std::unordered_map<std::string, code_t> codes;
+
+  public:
+    Dictionary() : names(), codes() { ; }
+
+    size_t size() const { return names.size(); }
+    void clear() { names.clear(); codes.clear(); }
+
+    const std::string & operator[](code_t code) const {
+      emp_assert(code >= 0 && (size_t) code < names.size(), code, names.size());
+      return names[(size_t) code];
+    }
+
+    const emp::vector<std::string> & GetNames() const { return names; }
+
+    /// Lookup the code for name; returns -1 if name is not in the dictionary.
+    code_t Find(const std::string & name) const {
+      auto it = codes.find(name);
+      return (it == codes.end()) ? -1 : it->second;
+    }
+
+    /// Lookup the code for name, adding name to the dictionary if necessary.
+    code_t Insert(const std::string & name) {
+      auto it = codes.find(name);
+      if (it != codes.end()) return it->second;
+      const code_t code = (code_t) names.size();
+      names.emplace_back(name);
+      codes.emplace(name, code);
+      return code;
+    }
+
+    size_t GetMemoryUsage() const {
+      size_t total = names.capacity() * sizeof(std::string);
+      for (const auto & name : names) total += 2 * name.capacity() + sizeof(code_t) + 2 * sizeof(void*);
+      return total;
+    }
+  };
+
+protected:
+  Dictionary state_dict;     ///< State names.
+  Dictionary category_dict;  ///< Categories (analogous to treatments).
+  Dictionary seqID_dict;     ///< Sequence IDs.
+
+  // Per-state columns.
+  emp::vector<code_t> states;     ///< State code for each state.
+  emp::vector<double> starts;     ///< Start value for each state.
+  emp::vector<double> durations;  ///< Duration value for each state.
+
+  // Per-sequence columns.
+  emp::vector<index_t> seq_begins;      ///< Index of each sequence's first state.
+  emp::vector<index_t> seq_lengths;     ///< Number of states in each sequence.
+  emp::vector<code_t> seq_categories;   ///< Category code of each sequence.
+  emp::vector<code_t> seq_ids;          ///< Sequence ID code of each sequence.
+
+  // Per-category information.
+  emp::vector<Domain> domains;                    ///< x/y domain of each category.
+  emp::vector<emp::vector<code_t>> category_ids;  ///< Unique sequence IDs in each category (first-appearance order).
+  emp::vector<emp::vector<index_t>> category_seqs;  ///< Index of the sequences in each category (file order).
+  std::unordered_set<uint64_t> category_id_set;   ///< (category, seqID) pairs seen so far.
+
+  // Growing sequences in place (see ExtendSequence).
+  std::unordered_map<index_t, index_t> seq_capacities;  ///< Room reserved for sequences moved to grow.
+  emp::vector<index_t> extended_seqs;                   ///< Sequences extended since ClearExtendedSequences.
+  mutable std::unordered_map<uint64_t, index_t> seq_lookup;  ///< (category, seqID) -> latest sequence.
+  mutable size_t seq_lookup_size;                            ///< Number of sequences in seq_lookup.
+
+  std::string error;  ///< Description of the most recent load failure.
+
+  // Scratch space reused between rows.
+  emp::vector<std::string> fields;
+  emp::vector<std::string> state_tokens;
+  emp::vector<double> start_values;
+  emp::vector<double> duration_values;
+
+  static uint64_t CategoryIDKey(code_t cat, code_t id) {
+    return (((uint64_t) (uint32_t) cat) << 32) | (uint64_t) (uint32_t) id;
+  }
+
+  /// Split str on delim into tokens (reusing token storage). Mirrors JS String.split:
+  /// an empty input yields one empty token.
+  static size_t SplitTokens(const std::string & str, const std::string & delim,
+                            emp::vector<std::string> & tokens) {
+    size_t count = 0;
+    size_t pos = 0;
+    while (true) {
+      const size_t next = delim.empty() ? std::string::npos : str.find(delim, pos);
+      if (count == tokens.size()) tokens.emplace_back();
+      if (next == std::string::npos) {
+        tokens[count++].assign(str, pos, std::string::npos);
+        break;
+      }
+      tokens[count++].assign(str, pos, next - pos);
+      pos = next + delim.size();
+    }
+    return count;
+  }
+
+  /// Split str on delim and convert each token to a number. Mirrors JS Number(): surrounding
+  /// whitespace is ignored and an empty token is 0. Returns false on a malformed token.
+  static bool SplitNumbers(const std::string & str, const std::string & delim,
+                           emp::vector<double> & values) {
+    values.clear();
+    std::string token;
+    size_t pos = 0;
+    while (true) {
+      const size_t next = delim.empty() ? std::string::npos : str.find(delim, pos);
+      const size_t end = (next == std::string::npos) ? str.size() : next;
+      size_t b = pos, e = end;
+      while (b < e && std::isspace((unsigned char) str[b])) ++b;
+      while (e > b && std::isspace((unsigned char) str[e-1])) --e;
+      if (b == e) {
+        values.push_back(0.0);
+      } else {
+        token.assign(str, b, e - b);  // Isolate token so strtod cannot read past it.
+        char * last = nullptr;
+        const double val = std::strtod(token.c_str(), &last);
+        if (last != token.c_str() + token.size()) return false;
+        values.push_back(val);
+      }
+      if (next == std::string::npos) break;
+      pos = next + delim.size();
+    }
+    return true;
+  }
+
+  /// Split a single CSV record in [begin, end) into fields (RFC 4180 quoting).
+  /// Records may not contain embedded newlines.
+  static size_t SplitCSVRow(const char * begin, const char * end, emp::vector<std::string> & out) {
+    size_t count = 0;
+    const char * cur = begin;
+    while (true) {
+      if (count == out.size()) out.emplace_back();
+      std::string & field = out[count++];
+      field.clear();
+      if (cur < end && *cur == '"') {
+        ++cur;
+        while (cur < end) {
+          if (*cur == '"') {
+            if (cur + 1 < end && cur[1] == '"') { field.push_back('"'); cur += 2; continue; }
+            ++cur;
+            break;
+          }
+          field.push_back(*cur++);
+        }
+        while (cur < end && *cur != ',') field.push_back(*cur++);
+      } else {
+        const char * field_end = cur;
+        while (field_end < end && *field_end != ',') ++field_end;
+        field.assign(cur, field_end);
+        cur = field_end;
+      }
+      if (cur >= end) break;
+      ++cur;  // Skip comma.
+    }
+    return count;
+  }
+
+  /// Trim a trailing carriage return from a line.
+  static const char * LineEnd(const char * begin, const char * end) {
+    return (end > begin && end[-1] == '\r') ? end - 1 : end;
+  }
+
+  /// Add the sequence described by one CSV record. Blank lines are skipped.
+  bool ParseCSVRecord(const char * begin, const char * end, const CSVColumns & cols, size_t line_num) {
+    end = LineEnd(begin, end);
+    if (begin == end) return true;
+    const size_t count = SplitCSVRow(begin, end, fields);
+    if (count < cols.num_columns) {
+      error = "Line " + std::to_string(line_num) + ": expected " + std::to_string(cols.num_columns)
+            + " fields, found " + std::to_string(count) + ".";
+      return false;
+    }
+    const bool ok = cols.extend
+      ? AddOrExtendSequence(fields[cols.category], fields[cols.seqID], fields[cols.states],
+                            fields[cols.starts], fields[cols.durations], cols.schema.delim)
+      : AddSequence(fields[cols.category], fields[cols.seqID], fields[cols.states],
+                    fields[cols.starts], fields[cols.durations], cols.schema.delim);
+    if (!ok) {
+      error = "Line " + std::to_string(line_num) + ": " + error;
+      return false;
+    }
+    return true;
+  }
+
+public:
+  StateSequenceDataset()
+    : state_dict(), category_dict(), seqID_dict(), states(), starts(), durations(),
+      seq_begins(), seq_lengths(), seq_categories(), seq_ids(), domains(), category_ids(), category_seqs(),
+      category_id_set(), seq_capacities(), extended_seqs(), seq_lookup(), seq_lookup_size(0), error(), fields(), state_tokens(), start_values(), duration_values()
+  { ; }
+
+  /// Remove all data.
+  void Clear() {
+    state_dict.clear(); category_dict.clear(); seqID_dict.clear();
+    states.clear(); starts.clear(); durations.clear();
+    seq_begins.clear(); seq_lengths.clear(); seq_categories.clear(); seq_ids.clear();
+    domains.clear(); category_ids.clear(); category_seqs.clear(); category_id_set.clear();
+    seq_capacities.clear(); extended_seqs.clear(); seq_lookup.clear(); seq_lookup_size = 0;
+    error.clear();
+  }
+
+  /// Size of the state columns. (This includes any room left behind by ExtendSequence, which is not
+  /// part of any sequence.)
+  size_t GetNumStates() const { return states.size(); }
+  size_t GetNumSequences() const { return seq_begins.size(); }
+  size_t GetNumCategories() const { return category_dict.size(); }
+
+  const Dictionary & GetStateDictionary() const { return state_dict; }
+  const Dictionary & GetCategoryDictionary() const { return category_dict; }
+  const Dictionary & GetSequenceIDDictionary() const { return seqID_dict; }
+
+  /// Get state names, indexed by state code.
+  const emp::vector<std::string> & GetStateNames() const { return state_dict.GetNames(); }
+
+  /// Get categories in order of first appearance, indexed by category code.
+  const emp::vector<std::string> & GetCategories() const { return category_dict.GetNames(); }
+
+  /// Get category code for cat (-1 if cat is not in the dataset).
+  code_t GetCategoryCode(const std::string & cat) const { return category_dict.Find(cat); }
+
+  const emp::vector<code_t> & GetStates() const { return states; }
+  const emp::vector<double> & GetStarts() const { return starts; }
+  const emp::vector<double> & GetDurations() const { return durations; }
+  const emp::vector<index_t> & GetSequenceBegins() const { return seq_begins; }
+  const emp::vector<index_t> & GetSequenceLengths() const { return seq_lengths; }
+  const emp::vector<code_t> & GetSequenceCategories() const { return seq_categories; }
+  const emp::vector<code_t> & GetSequenceIDs() const { return seq_ids; }
+
+  /// Get the x/y domain of category cat.
+  const Domain & GetDomain(code_t cat) const {
+    emp_assert(cat >= 0 && (size_t) cat < domains.size(), cat, domains.size());
+    return domains[(size_t) cat];
+  }
+
+  /// Get the unique sequence IDs found in category cat (in order of first appearance).
+  const emp::vector<code_t> & GetCategorySequenceIDs(code_t cat) const {
+    emp_assert(cat >= 0 && (size_t) cat < category_ids.size(), cat, category_ids.size());
+    return category_ids[(size_t) cat];
+  }
+
+  /// Get the indices of all sequences in category cat (in file order).
+  const emp::vector<index_t> & GetCategorySequences(code_t cat) const {
+    emp_assert(cat >= 0 && (size_t) cat < category_seqs.size(), cat, category_seqs.size());
+    return category_seqs[(size_t) cat];
+  }
+
+  /// Description of why the most recent load failed.
+  const std::string & GetError() const { return error; }
+
+  /// Approximate number of bytes held by this dataset.
+  size_t GetMemoryUsage() const {
+    size_t total = state_dict.GetMemoryUsage() + category_dict.GetMemoryUsage() + seqID_dict.GetMemoryUsage();
+    total += states.capacity() * sizeof(code_t);
+    total += (starts.capacity() + durations.capacity()) * sizeof(double);
+    total += (seq_begins.capacity() + seq_lengths.capacity()) * sizeof(index_t);
+    total += (seq_categories.capacity() + seq_ids.capacity()) * sizeof(code_t);
+    total += domains.capacity() * sizeof(Domain);
+    for (const auto & ids : category_ids) total += ids.capacity() * sizeof(code_t);
+    for (const auto & seqs : category_seqs) total += seqs.capacity() * sizeof(index_t);
+    total += category_id_set.size() * (sizeof(uint64_t) + 2 * sizeof(void*));
+    total += seq_capacities.size() * (2 * sizeof(index_t) + 2 * sizeof(void*));
+    total += extended_seqs.capacity() * sizeof(index_t);
+    total += seq_lookup.size() * (sizeof(uint64_t) + sizeof(index_t) + 2 * sizeof(void*));
+    return total;
+  }
+
+  /// Do two datasets hold exactly the same sequences, dictionaries and domains?
+  bool operator==(const StateSequenceDataset & other) const {
+    return state_dict.GetNames() == other.state_dict.GetNames()
+        && category_dict.GetNames() == other.category_dict.GetNames()
+        && seqID_dict.GetNames() == other.seqID_dict.GetNames()
+        && states == other.states && starts == other.starts && durations == other.durations
+        && seq_begins == other.seq_begins && seq_lengths == other.seq_lengths
+        && seq_categories == other.seq_categories && seq_ids == other.seq_ids
+        && domains == other.domains && category_ids == other.category_ids
+        && category_seqs == other.category_seqs;
+  }
+  bool operator!=(const StateSequenceDataset & other) const { return !(*this == other); }
+
+  /// Split the (delimited) states, starts and durations of sequence seqID into state_tokens,
+  /// start_values and duration_values. Returns the number of states (0 if they are malformed).
+  size_t SplitStates(const std::string & seqID, const std::string & states_str, const std::string & starts_str,
+                     const std::string & durations_str, const std::string & delim) {
+    const size_t num_states = SplitTokens(states_str, delim, state_tokens);
+    if (!SplitNumbers(starts_str, delim, start_values)) {
+      error = "Malformed state start value in '" + starts_str + "'.";
+      return 0;
+    }
+    if (!SplitNumbers(durations_str, delim, duration_values)) {
+      error = "Malformed state duration value in '" + durations_str + "'.";
+      return 0;
+    }
+    if (start_values.size() != num_states || duration_values.size() != num_states) {
+      error = "Sequence '" + seqID + "' has " + std::to_string(num_states) + " states, "
+            + std::to_string(start_values.size()) + " starts and "
+            + std::to_string(duration_values.size()) + " durations.";
+      return 0;
+    }
+    return num_states;
+  }
+
+  /// Add a single sequence given its (delimited) states, starts and durations.
+  /// Returns false (leaving the dataset unchanged) if the sequence is malformed.
+  bool AddSequence(const std::string & category, const std::string & seqID,
+                   const std::string & states_str, const std::string & starts_str,
+                   const std::string & durations_str, const std::string & delim) {
+    const size_t num_states = SplitStates(seqID, states_str, starts_str, durations_str, delim);
+    if (num_states == 0) return false;
+
+    // Build up a list of categories.
+    const code_t cat = category_dict.Insert(category);
+    if ((size_t) cat == domains.size()) {
+      domains.emplace_back(0.0, 0.0, start_values[0], start_values[0] + duration_values[0]);
+      category_ids.emplace_back();
+      category_seqs.emplace_back();
+    }
+    // Ensure that sequence IDs are unique within a category.
+    const code_t id = seqID_dict.Insert(seqID);
+    if (category_id_set.insert(CategoryIDKey(cat, id)).second) {
+      category_ids[(size_t) cat].push_back(id);
+    }
+
+    Domain & domain = domains[(size_t) cat];
+    domain.x_max += 1;
+    emp_assert(states.size() + num_states <= (size_t) UINT32_MAX, "Too many states for index_t.");
+    category_seqs[(size_t) cat].push_back((index_t) seq_begins.size());
+    seq_begins.push_back((index_t) states.size());
+    seq_lengths.push_back((index_t) num_states);
+    seq_categories.push_back(cat);
+    seq_ids.push_back(id);
+    for (size_t i = 0; i < num_states; ++i) {
+      const double end = start_values[i] + duration_values[i];
+      if (domain.y_max < end) domain.y_max = end;
+      if (domain.y_min > start_values[i]) domain.y_min = start_values[i];
+      states.push_back(state_dict.Insert(state_tokens[i]));
+      starts.push_back(start_values[i]);
+      durations.push_back(duration_values[i]);
+    }
+    return true;
+  }
+
+  /// Find the (most recently added) sequence with seqID in category; returns NO_SEQUENCE if there is
+  /// none. The lookup table is brought up to date with sequences added since the last call.
+  index_t FindSequence(const std::string & category, const std::string & seqID) const {
+    const code_t cat = category_dict.Find(category);
+    const code_t id = seqID_dict.Find(seqID);
+    if (cat == -1 || id == -1) return NO_SEQUENCE;
+    if (seq_lookup_size > seq_begins.size()) {
+      seq_lookup.clear();
+      seq_lookup_size = 0;
+    }
+    for (; seq_lookup_size < seq_begins.size(); ++seq_lookup_size) {
+      seq_lookup[CategoryIDKey(seq_categories[seq_lookup_size], seq_ids[seq_lookup_size])] = (index_t) seq_lookup_size;
+    }
+    auto it = seq_lookup.find(CategoryIDKey(cat, id));
+    return (it == seq_lookup.end()) ? NO_SEQUENCE : it->second;
+  }
+
+  /// Add states (delimited, as for AddSequence) to the end of sequence seq, updating its category's
+  /// domain. A sequence is a range of the state columns, so one that cannot grow where it is moves to
+  /// the end of the columns first, with as much room again as it needs (its old range is left unused):
+  /// extending a sequence costs amortized time proportional to the states added.
+  /// Returns false (leaving the dataset unchanged) if the states are malformed.
+  bool ExtendSequence(index_t seq, const std::string & states_str, const std::string & starts_str,
+                      const std::string & durations_str, const std::string & delim) {
+    emp_assert(seq < seq_begins.size(), seq, seq_begins.size());
+    const std::string & seqID = seqID_dict[seq_ids[seq]];
+    const size_t num_new = SplitStates(seqID, states_str, starts_str, durations_str, delim);
+    if (num_new == 0) return false;
+    const size_t begin = seq_begins[seq];
+    const size_t length = seq_lengths[seq];
+    auto cap_it = seq_capacities.find(seq);
+    size_t capacity = (cap_it == seq_capacities.end()) ? length : cap_it->second;
+    size_t first = begin;
+    if (length + num_new > capacity) {
+      if (begin + capacity == states.size()) {
+        // Last range in the columns: grow it in place.
+        capacity = length + num_new;
+      } else {
+        capacity = 2 * (length + num_new);
+        first = states.size();
+      }
+      emp_assert(first + capacity <= (size_t) UINT32_MAX, "Too many states for index_t.");
+      states.resize(std::max(states.size(), first + capacity));
+      starts.resize(states.size());
+      durations.resize(states.size());
+      if (first != begin) {
+        std::copy(states.begin() + begin, states.begin() + begin + length, states.begin() + first);
+        std::copy(starts.begin() + begin, starts.begin() + begin + length, starts.begin() + first);
+        std::copy(durations.begin() + begin, durations.begin() + begin + length, durations.begin() + first);
+      }
+      seq_capacities[seq] = (index_t) capacity;
+    }
+
+    Domain & domain = domains[(size_t) seq_categories[seq]];
+    for (size_t i = 0; i < num_new; ++i) {
+      const size_t k = first + length + i;
+      const double end = start_values[i] + duration_values[i];
+      if (domain.y_max < end) domain.y_max = end;
+      if (domain.y_min > start_values[i]) domain.y_min = start_values[i];
+      states[k] = state_dict.Insert(state_tokens[i]);
+      starts[k] = start_values[i];
+      durations[k] = duration_values[i];
+    }
+    seq_begins[seq] = (index_t) first;
+    seq_lengths[seq] = (index_t) (length + num_new);
+    extended_seqs.push_back(seq);
+    return true;
+  }
+
+  /// Add a sequence, or extend the existing sequence with seqID in category if there is one.
+  bool AddOrExtendSequence(const std::string & category, const std::string & seqID,
+                           const std::string & states_str, const std::string & starts_str,
+                           const std::string & durations_str, const std::string & delim) {
+    const index_t seq = FindSequence(category, seqID);
+    if (seq == NO_SEQUENCE) return AddSequence(category, seqID, states_str, starts_str, durations_str, delim);
+    return ExtendSequence(seq, states_str, starts_str, durations_str, delim);
+  }
+
+  /// Sequences extended (see ExtendSequence) since the last call to ClearExtendedSequences, in the
+  /// order they were extended (a sequence extended more than once may appear more than once).
+  const emp::vector<index_t> & GetExtendedSequences() const { return extended_seqs; }
+  void ClearExtendedSequences() { extended_seqs.clear(); }
+
+  /// Locate schema columns in the CSV header line [begin, end).
+  bool ParseCSVHeader(const char * begin, const char * end, CSVColumns & cols) {
+    const size_t count = SplitCSVRow(begin, LineEnd(begin, end), fields);
+    const std::string * wanted[5] = { &cols.schema.states, &cols.schema.starts, &cols.schema.durations,
+                                      &cols.schema.category, &cols.schema.seqID };
+    size_t * found[5] = { &cols.states, &cols.starts, &cols.durations, &cols.category, &cols.seqID };
+    for (size_t w = 0; w < 5; ++w) {
+      size_t col = 0;
+      while (col < count && fields[col] != *wanted[w]) ++col;
+      if (col == count) {
+        error = "Failed to find column '" + *wanted[w] + "' in CSV header.";
+        return false;
+      }
+      *found[w] = col;
+    }
+    cols.num_columns = count;
+    return true;
+  }
+
+  /// Append the sequences in [begin, end), a block of complete CSV records (no header).
+  /// first_line is the line number of the first record (for error messages).
+  bool AppendCSVRecords(const char * begin, const char * end, const CSVColumns & cols, size_t first_line=2) {
+    size_t line_num = first_line;
+    const char * line = begin;
+    while (line < end) {
+      const char * line_end = line;
+      while (line_end < end && *line_end != '\n') ++line_end;
+      if (!ParseCSVRecord(line, line_end, cols, line_num)) return false;
+      line = line_end + 1;
+      ++line_num;
+    }
+    return true;
+  }
+
+  /// Load CSV data from an in-memory buffer, replacing any existing data.
+  /// The first line must be a header naming the columns given in schema.
+  bool LoadCSVText(const char * text, size_t size, const Schema & schema) {
+    Clear();
+    CSVColumns cols(schema);
+    const char * end = text + size;
+    const char * header_end = text;
+    while (header_end < end && *header_end != '\n') ++header_end;
+    if (size == 0) {
+      error = "CSV data is empty.";
+      return false;
+    }
+    if (!ParseCSVHeader(text, header_end, cols)) return false;
+    if (header_end == end) return true;
+    return AppendCSVRecords(header_end + 1, end, cols);
+  }
+
+  /// Load CSV data from a stream, replacing any existing data.
+  bool LoadCSV(std::istream & is, const Schema & schema) {
+    Clear();
+    CSVColumns cols(schema);
+    std::string line;
+    size_t line_num = 0;
+    while (std::getline(is, line)) {
+      ++line_num;
+      const char * begin = line.c_str();
+      const bool ok = (line_num == 1) ? ParseCSVHeader(begin, begin + line.size(), cols)
+                                      : ParseCSVRecord(begin, begin + line.size(), cols, line_num);
+      if (!ok) return false;
+    }
+    if (line_num == 0) {
+      error = "CSV data is empty.";
+      return false;
+    }
+    return true;
+  }
+
+  /// Load CSV data from the file filename, replacing any existing data.
+  bool LoadCSV(const std::string & filename, const Schema & schema) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+      Clear();
+      error = "Unable to open file '" + filename + "'.";
+      return false;
+    }
+    return LoadCSV(file, schema);
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef STATE_SEQUENCE_DATASET_STORE_H
+#define STATE_SEQUENCE_DATASET_STORE_H
+
+#include <string>
+#include <map>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+#include "base/vector.h"
+
+#include "StateSequenceCSVStream.h"
+#include "StateSequenceDataset.h"
+#include "StateSequenceIntervalIndex.h"
+
+namespace emp {
+
+/// Registry of parsed state sequence datasets, keyed by where the data came from and how it was
+/// parsed (see MakeKey). Every user of a key gets the same reference-counted Source, so a file shown
+/// in several views is loaded once and held once; a Source (and its registry slot) goes away with
+/// its last user.
+class StateSequenceDatasetStore {
+public:
+  using Schema = StateSequenceDataset::Schema;
+
+  /// One shared dataset, along with how far loading it has gotten and who wants to hear about it.
+  struct Source {
+    enum class Status { LOADING=0, LOADED, FAILED };
+
+    /// Sent to listeners: new sequences are available (DATA), or the load has FINISHED.
+    enum class Notice { DATA=0, FINISHED };
+    using listener_t = std::function<void(Notice)>;
+
+    std::string key;
+    size_t id;                                  ///< Unique among sources (0 for unregistered ones).
+    Status status;
+    std::string error;                          ///< Why the load failed (if it did).
+    StateSequenceDataset dataset;
+    StateSequenceIntervalIndex interval_index;  ///< Kept up to date with dataset by its loader.
+    std::map<size_t, listener_t> listeners;
+    size_t next_listener;
+
+    // How much of dataset has been handed to the (shared) JS data so far.
+    size_t exported_seqs;
+    size_t exported_states;
+    size_t exported_state_names;
+    size_t exported_seqIDs;
+    size_t exported_categories;
+    emp::vector<StateSequenceDataset::index_t> extended;  ///< Sequences extended by the latest DATA notice.
+
+    // Appending to a loaded source (live mode).
+    StateSequenceCSVStream live_stream;   ///< Parses appended records (set up once loading has finished).
+    size_t file_offset;                   ///< Bytes of the source file read so far (where following it resumes).
+    bool compressed;                      ///< Was the input compressed? (Its tail cannot be followed.)
+
+    Source(const std::string & _key="", size_t _id=0)
+      : key(_key), id(_id), status(Status::LOADING), error(), dataset(), interval_index(),
+        listeners(), next_listener(0),
+        exported_seqs(0), exported_states(0), exported_state_names(0), exported_seqIDs(0), exported_categories(0),
+        extended(), live_stream(), file_offset(0), compressed(false)
+    { ; }
+
+    /// Call fun with every notice from now on; returns an ID for RemoveListener.
+    size_t AddListener(const listener_t & fun) {
+      listeners[next_listener] = fun;
+      return next_listener++;
+    }
+
+    void RemoveListener(size_t listener_id) { listeners.erase(listener_id); }
+
+    /// Forget all data, ready to be loaded (again).
+    void Reset() {
+      status = Status::LOADING;
+      error.clear();
+      dataset.Clear();
+      interval_index.Clear();
+      exported_seqs = exported_states = exported_state_names = exported_seqIDs = exported_categories = 0;
+      extended.clear();
+      live_stream.Reset(StateSequenceDataset::Schema());
+      file_offset = 0;
+      compressed = false;
+    }
+
+    /// Tell every listener about notice. (Listeners may add or remove listeners as they go.)
+    void Notify(Notice notice) {
+      emp::vector<listener_t> funs;
+      for (const auto & entry : listeners) funs.push_back(entry.second);
+      for (const auto & fun : funs) fun(notice);
+    }
+  };
+
+protected:
+  std::unordered_map<std::string, std::weak_ptr<Source>> sources;
+  size_t next_id;
+
+public:
+  StateSequenceDatasetStore() : sources(), next_id(1) { ; }
+
+  StateSequenceDatasetStore(const StateSequenceDatasetStore &) = delete;
+  StateSequenceDatasetStore & operator=(const StateSequenceDatasetStore &) = delete;
+
+  /// The store shared by every visualization.
+  static StateSequenceDatasetStore & Global() {
+    static StateSequenceDatasetStore store;
+    return store;
+  }
+
+  /// Key for data read from location (a file name or URL, prefixed by its format) with schema.
+  static std::string MakeKey(const std::string & location, const Schema & schema=Schema()) {
+    std::string key = location;
+    for (const std::string * field : { &schema.states, &schema.starts, &schema.durations,
+                                       &schema.category, &schema.seqID, &schema.delim }) {
+      key += '\n';
+      key += *field;
+    }
+    return key;
+  }
+
+  /// Get the source for key, creating it (empty and LOADING) if nobody holds it; created says which.
+  std::shared_ptr<Source> Acquire(const std::string & key, bool & created) {
+    std::weak_ptr<Source> & slot = sources[key];
+    std::shared_ptr<Source> source = slot.lock();
+    created = !source;
+    if (created) {
+      source = std::make_shared<Source>(key, next_id++);
+      slot = source;
+    }
+    Purge();
+    return source;
+  }
+
+  /// Get the source for key if somebody holds it (nullptr otherwise).
+  std::shared_ptr<Source> Find(const std::string & key) const {
+    auto it = sources.find(key);
+    return (it == sources.end()) ? nullptr : it->second.lock();
+  }
+
+  /// Drop registry slots of sources nobody holds anymore.
+  void Purge() {
+    for (auto it = sources.begin(); it != sources.end();) {
+      if (it->second.expired()) it = sources.erase(it);
+      else ++it;
+    }
+  }
+
+  /// Number of sources currently held by somebody.
+  size_t GetNumSources() const {
+    size_t count = 0;
+    for (const auto & entry : sources) count += entry.second.expired() ? 0 : 1;
+    return count;
+  }
+
+  /// Approximate number of bytes held by the datasets of all live sources.
+  size_t GetMemoryUsage() const {
+    size_t total = 0;
+    for (const auto & entry : sources) {
+      if (auto source = entry.second.lock()) total += source->dataset.GetMemoryUsage();
+    }
+    return total;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef STATE_SEQUENCE_DECOMPRESSOR_H
+#define STATE_SEQUENCE_DECOMPRESSOR_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+
+#include "base/vector.h"
+
+#ifdef STATE_SEQ_VIS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef STATE_SEQ_VIS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace emp {
+
+/// Streaming decompression of (possibly) compressed input: feed it arbitrary-sized chunks of a file
+/// and the decompressed bytes are handed to a sink as they come out, in pieces of at most the output
+/// buffer size. Neither the compressed nor the decompressed file is ever held whole. The format is
+/// detected from the first bytes of input; plain input passes straight through.
+/// Each compressed format is only supported when built with its library:
+///   * gzip (and zlib): define STATE_SEQ_VIS_ZLIB and link with -lz (emcc: -s USE_ZLIB=1).
+///   * zstd: define STATE_SEQ_VIS_ZSTD and link with -lzstd.
+class StateSequenceDecompressor {
+public:
+  enum class Format { UNKNOWN=0, PLAIN, GZIP, ZSTD };
+
+  /// Receives each piece of decompressed output; returns false to abort.
+  using sink_t = std::function<bool(const char *, size_t)>;
+
+  /// Number of leading bytes needed to tell formats apart.
+  static constexpr size_t MAGIC_SIZE = 4;
+
+protected:
+  Format format;
+  bool failed;
+  bool done;            ///< Has the compressed stream ended (no more input expected)?
+  std::string head;     ///< Input held back until there is enough of it to detect the format.
+  emp::vector<char> out_buffer;
+  std::string error;
+
+#ifdef STATE_SEQ_VIS_ZLIB
+  z_stream zlib;
+  bool zlib_open;
+#endif
+#ifdef STATE_SEQ_VIS_ZSTD
+  ZSTD_DStream * zstd;
+  size_t zstd_pending;  ///< Last ZSTD_decompressStream result (0 between frames).
+#endif
+
+  bool Fail(const std::string & msg) {
+    failed = true;
+    error = msg;
+    return false;
+  }
+
+  void Close() {
+#ifdef STATE_SEQ_VIS_ZLIB
+    if (zlib_open) inflateEnd(&zlib);
+    zlib_open = false;
+#endif
+#ifdef STATE_SEQ_VIS_ZSTD
+    if (zstd) ZSTD_freeDStream(zstd);
+    zstd = nullptr;
+#endif
+  }
+
+  /// Pick the format from the first bytes of input and get ready to decode it.
+  bool Open(const char * magic, size_t size) {
+    format = Detect(magic, size);
+    if (!IsSupported(format)) {
+      return Fail(std::string("Input is ") + GetFormatName(format) + "-compressed, but this build "
+                  "does not support it.");
+    }
+#ifdef STATE_SEQ_VIS_ZLIB
+    if (format == Format::GZIP) {
+      std::memset(&zlib, 0, sizeof(zlib));
+      // 15 + 32: largest window, and accept both gzip and zlib headers.
+      if (inflateInit2(&zlib, 15 + 32) != Z_OK) return Fail("Unable to start gzip decompression.");
+      zlib_open = true;
+    }
+#endif
+#ifdef STATE_SEQ_VIS_ZSTD
+    if (format == Format::ZSTD) {
+      zstd = ZSTD_createDStream();
+      if (zstd == nullptr || ZSTD_isError(ZSTD_initDStream(zstd))) return Fail("Unable to start zstd decompression.");
+      zstd_pending = 0;
+    }
+#endif
+    return true;
+  }
+
+  /// Decode size bytes of input (in a format we have opened) into sink.
+  bool Decode(const char * in, size_t size, const sink_t & sink) {
+    if (format == Format::PLAIN) return size == 0 || sink(in, size) || Fail("");
+#ifdef STATE_SEQ_VIS_ZLIB
+    if (format == Format::GZIP) {
+      zlib.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+      zlib.avail_in = (uInt) size;
+      for (;;) {
+        if (done) {
+          if (zlib.avail_in == 0) break;
+          // Another gzip member follows (e.g., concatenated files).
+          if (inflateReset(&zlib) != Z_OK) return Fail("Unable to restart gzip decompression.");
+          done = false;
+        }
+        zlib.next_out = reinterpret_cast<Bytef *>(out_buffer.data());
+        zlib.avail_out = (uInt) out_buffer.size();
+        const int result = inflate(&zlib, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+          return Fail(std::string("Corrupt gzip data") + (zlib.msg ? std::string(": ") + zlib.msg : "") + ".");
+        }
+        const size_t produced = out_buffer.size() - zlib.avail_out;
+        if (produced > 0 && !sink(out_buffer.data(), produced)) return Fail("");
+        if (result == Z_STREAM_END) done = true;
+        // inflate only stops short of filling the output buffer once it has used up the input.
+        else if (zlib.avail_out != 0) break;
+      }
+      return true;
+    }
+#endif
+#ifdef STATE_SEQ_VIS_ZSTD
+    if (format == Format::ZSTD) {
+      ZSTD_inBuffer input = { in, size, 0 };
+      // Keep going until the input is used up and the output buffer was not filled (nothing left over).
+      bool full = true;
+      while (input.pos < input.size || full) {
+        ZSTD_outBuffer output = { out_buffer.data(), out_buffer.size(), 0 };
+        zstd_pending = ZSTD_decompressStream(zstd, &output, &input);
+        if (ZSTD_isError(zstd_pending)) {
+          return Fail(std::string("Corrupt zstd data: ") + ZSTD_getErrorName(zstd_pending) + ".");
+        }
+        if (output.pos > 0 && !sink(out_buffer.data(), output.pos)) return Fail("");
+        full = (output.pos == output.size);
+      }
+      return true;
+    }
+#endif
+    return Fail("Unsupported input format.");
+  }
+
+public:
+  StateSequenceDecompressor(size_t out_size=(1 << 16))
+    : format(Format::UNKNOWN), failed(false), done(false), head(), out_buffer(out_size), error()
+#ifdef STATE_SEQ_VIS_ZLIB
+      , zlib(), zlib_open(false)
+#endif
+#ifdef STATE_SEQ_VIS_ZSTD
+      , zstd(nullptr), zstd_pending(0)
+#endif
+  { ; }
+
+  StateSequenceDecompressor(const StateSequenceDecompressor &) = delete;
+  StateSequenceDecompressor & operator=(const StateSequenceDecompressor &) = delete;
+
+  ~StateSequenceDecompressor() { Close(); }
+
+  /// Identify the format of data from its first size bytes (see MAGIC_SIZE).
+  static Format Detect(const void * data, size_t size) {
+    const unsigned char * bytes = static_cast<const unsigned char *>(data);
+    if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b) return Format::GZIP;
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd) {
+      return Format::ZSTD;
+    }
+    return Format::PLAIN;
+  }
+
+  /// Can this build decode format?
+  static bool IsSupported(Format format) {
+    switch (format) {
+      case Format::PLAIN: return true;
+#ifdef STATE_SEQ_VIS_ZLIB
+      case Format::GZIP: return true;
+#endif
+#ifdef STATE_SEQ_VIS_ZSTD
+      case Format::ZSTD: return true;
+#endif
+      default: return false;
+    }
+  }
+
+  static const char * GetFormatName(Format format) {
+    switch (format) {
+      case Format::PLAIN: return "plain";
+      case Format::GZIP: return "gzip";
+      case Format::ZSTD: return "zstd";
+      default: return "unknown";
+    }
+  }
+
+  /// Start a new stream (of any format).
+  void Reset() {
+    Close();
+    format = Format::UNKNOWN;
+    failed = false;
+    done = false;
+    head.clear();
+    error.clear();
+  }
+
+  Format GetFormat() const { return format; }
+  bool HasFailed() const { return failed; }
+  const std::string & GetError() const { return error; }
+
+  /// Decompress the next size bytes of input into sink. (Fails without a message if sink does.)
+  bool Feed(const char * in, size_t size, const sink_t & sink) {
+    if (failed) return false;
+    if (format == Format::UNKNOWN) {
+      // Hold input back until we can tell what it is.
+      if (head.size() + size < MAGIC_SIZE) {
+        head.append(in, size);
+        return true;
+      }
+      if (!head.empty()) {
+        const size_t used = MAGIC_SIZE - head.size();
+        head.append(in, used);
+        if (!Open(head.data(), head.size()) || !Decode(head.data(), head.size(), sink)) return false;
+        head.clear();
+        in += used;
+        size -= used;
+      } else if (!Open(in, size)) {
+        return false;
+      }
+    }
+    return Decode(in, size, sink);
+  }
+
+  /// Signal the end of input; fails if the compressed stream was cut short.
+  bool Finish(const sink_t & sink) {
+    if (failed) return false;
+    if (format == Format::UNKNOWN) {
+      // Fewer than MAGIC_SIZE bytes in all.
+      if (!Open(head.data(), head.size()) || !Decode(head.data(), head.size(), sink)) return false;
+      head.clear();
+    }
+    if (format == Format::GZIP && !done) return Fail("Unexpected end of gzip data.");
+#ifdef STATE_SEQ_VIS_ZSTD
+    if (format == Format::ZSTD && zstd_pending != 0) return Fail("Unexpected end of zstd data.");
+#endif
+    return true;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef STATE_SEQUENCE_FREQUENCY_H
+#define STATE_SEQUENCE_FREQUENCY_H
+
+#include <algorithm>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+#include "StateSequenceDataset.h"
+
+namespace emp {
+
+/// State frequencies over time for the categories of a StateSequenceDataset: the fraction of a
+/// category's sequences in each state at each point in time. Every state of a category becomes an
+/// enter and an exit event; events are sorted once per category (and cached), after which any time
+/// window can be sampled at any resolution with a single sweep over them.
+class StateSequenceFrequency {
+public:
+  using code_t = StateSequenceDataset::code_t;
+
+  /// A sequence entering (delta = +1) or leaving (delta = -1) state slot at time.
+  struct Event {
+    double time;
+    uint32_t slot;   ///< Index into the category's state list (see GetStates).
+    int32_t delta;
+
+    bool operator<(const Event & other) const { return time < other.time; }
+  };
+
+protected:
+  /// Sorted events of one category.
+  struct Entry {
+    bool valid;
+    size_t num_seqs;              ///< Category size the events were collected for.
+    emp::vector<Event> events;    ///< Sorted by time.
+    emp::vector<code_t> states;   ///< States occurring in the category (ascending codes).
+
+    Entry() : valid(false), num_seqs(0), events(), states() { ; }
+  };
+
+  emp::vector<Entry> entries;     ///< Per category code.
+
+  // Most recent sample.
+  code_t sample_cat;
+  size_t num_rows;
+  double y_min;
+  double y_max;
+  emp::vector<double> samples;    ///< Row-major: fraction of sequences per (row, state slot).
+
+  // Scratch space for the sweep.
+  emp::vector<long> counts;
+  emp::vector<double> integrals;
+  emp::vector<double> last_times;
+
+  /// Collect and sort the events of category cat.
+  static void BuildEntry(const StateSequenceDataset & data, code_t cat, Entry & entry) {
+    const auto & seqs = data.GetCategorySequences(cat);
+    const auto & begins = data.GetSequenceBegins();
+    const auto & lengths = data.GetSequenceLengths();
+    const auto & states = data.GetStates();
+    const auto & starts = data.GetStarts();
+    const auto & durations = data.GetDurations();
+    emp::vector<int32_t> slots(data.GetStateNames().size(), -1);
+    entry.states.clear();
+    for (size_t seq : seqs) {
+      for (size_t k = begins[seq]; k < begins[seq] + lengths[seq]; ++k) {
+        if (slots[(size_t) states[k]] == -1) {
+          slots[(size_t) states[k]] = 0;
+          entry.states.push_back(states[k]);
+        }
+      }
+    }
+    std::sort(entry.states.begin(), entry.states.end());
+    for (size_t i = 0; i < entry.states.size(); ++i) slots[(size_t) entry.states[i]] = (int32_t) i;
+
+    entry.events.clear();
+    for (size_t seq : seqs) {
+      for (size_t k = begins[seq]; k < begins[seq] + lengths[seq]; ++k) {
+        const uint32_t slot = (uint32_t) slots[(size_t) states[k]];
+        entry.events.push_back({ starts[k], slot, 1 });
+        entry.events.push_back({ starts[k] + durations[k], slot, -1 });
+      }
+    }
+    std::sort(entry.events.begin(), entry.events.end());
+    entry.num_seqs = seqs.size();
+    entry.valid = true;
+  }
+
+  /// Get the (up to date) events of category cat.
+  const Entry & GetEntry(const StateSequenceDataset & data, code_t cat) {
+    emp_assert(cat >= 0 && (size_t) cat < data.GetNumCategories(), cat, data.GetNumCategories());
+    if (entries.size() < data.GetNumCategories()) entries.resize(data.GetNumCategories());
+    Entry & entry = entries[(size_t) cat];
+    if (!entry.valid || entry.num_seqs != data.GetCategorySequences(cat).size()) BuildEntry(data, cat, entry);
+    return entry;
+  }
+
+public:
+  StateSequenceFrequency()
+    : entries(), sample_cat(-1), num_rows(0), y_min(0.0), y_max(0.0), samples(),
+      counts(), integrals(), last_times()
+  { ; }
+
+  /// Forget every cached category (e.g., when the dataset is replaced).
+  void Clear() {
+    entries.clear();
+    sample_cat = -1;
+    num_rows = 0;
+    samples.clear();
+  }
+
+  /// Forget category cat (e.g., when some of its sequences have been extended).
+  void Invalidate(code_t cat) {
+    if ((size_t) cat < entries.size()) entries[(size_t) cat].valid = false;
+  }
+
+  /// States occurring in category cat, in ascending code order (the stacking order of samples).
+  const emp::vector<code_t> & GetStates(const StateSequenceDataset & data, code_t cat) {
+    return GetEntry(data, cat).states;
+  }
+
+  /// Sample category cat of data over times [_y_min, _y_max] split into rows equal rows (e.g., one per
+  /// vertical pixel). Each sample is the fraction of the category's sequences in a state, averaged
+  /// over the row's time span. Cost is linear in the number of events plus rows times states.
+  void Sample(const StateSequenceDataset & data, code_t cat, double _y_min, double _y_max, size_t rows) {
+    const Entry & entry = GetEntry(data, cat);
+    const size_t num_states = entry.states.size();
+    sample_cat = cat;
+    num_rows = rows;
+    y_min = _y_min;
+    y_max = _y_max;
+    samples.assign(rows * num_states, 0.0);
+    if (rows == 0 || num_states == 0 || entry.num_seqs == 0) return;
+    const double extent = y_max - y_min;
+    const double row_size = (extent > 0.0) ? extent / (double) rows : 1.0;
+    const double scale = 1.0 / (row_size * (double) entry.num_seqs);
+
+    // Occupancy only changes at events, so each state's time integral is brought up to date lazily.
+    counts.assign(num_states, 0);
+    integrals.assign(num_states, 0.0);
+    last_times.assign(num_states, y_min);
+    const auto & events = entry.events;
+    size_t e = 0;
+    for (; e < events.size() && events[e].time <= y_min; ++e) counts[events[e].slot] += events[e].delta;
+    for (size_t row = 0; row < rows; ++row) {
+      const double row_end = y_min + row_size * (double) (row + 1);
+      for (; e < events.size() && events[e].time < row_end; ++e) {
+        const Event & event = events[e];
+        integrals[event.slot] += (double) counts[event.slot] * (event.time - last_times[event.slot]);
+        last_times[event.slot] = event.time;
+        counts[event.slot] += event.delta;
+      }
+      double * row_samples = samples.data() + row * num_states;
+      for (size_t s = 0; s < num_states; ++s) {
+        integrals[s] += (double) counts[s] * (row_end - last_times[s]);
+        row_samples[s] = integrals[s] * scale;
+        integrals[s] = 0.0;
+        last_times[s] = row_end;
+      }
+    }
+  }
+
+  code_t GetSampleCategory() const { return sample_cat; }
+  size_t GetNumRows() const { return num_rows; }
+  double GetSampleMin() const { return y_min; }
+  double GetSampleMax() const { return y_max; }
+
+  /// Samples from the most recent Sample call, row-major (one value per state of the category).
+  const emp::vector<double> & GetSamples() const { return samples; }
+
+  /// Fraction of sequences in state slot (see GetStates) during row of the most recent sample.
+  double GetFraction(size_t row, size_t slot) const {
+    const size_t num_states = num_rows ? samples.size() / num_rows : 0;
+    emp_assert(row < num_rows && slot < num_states, row, num_rows, slot, num_states);
+    return samples[row * num_states + slot];
+  }
+};
+
+}
+
+#endif
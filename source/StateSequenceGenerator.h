@@ -0,0 +1,112 @@
+#ifndef STATE_SEQUENCE_GENERATOR_H
+#define STATE_SEQUENCE_GENERATOR_H
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <cstdint>
+
+#include "StateSequenceDataset.h"
+
+namespace emp {
+
+/// Deterministic generator of synthetic state sequence CSVs (for benchmarks and testing).
+/// Every category gets the same number of sequences and every sequence the same number of
+/// states; states are drawn uniformly from an alphabet of "s0", "s1", ... and follow each other
+/// back to back with random durations. The output depends only on the configuration (including
+/// the seed): raw std::mt19937 output is fully specified by the standard, and we map it to ranges
+/// ourselves rather than relying on library-specific distributions.
+class StateSequenceGenerator {
+public:
+  struct Config {
+    size_t num_categories;          ///< Number of distinct categories.
+    size_t sequences_per_category;  ///< Sequences generated for each category.
+    size_t states_per_sequence;     ///< States in every sequence.
+    size_t alphabet_size;           ///< Number of distinct state names.
+    size_t max_duration;            ///< Durations are drawn from [1, max_duration].
+    uint32_t seed;                  ///< Random number seed.
+    size_t id_period;               ///< Sequence IDs repeat every id_period sequences of a category (0 = never).
+
+    Config(size_t _num_categories=4, size_t _sequences_per_category=100, size_t _states_per_sequence=10,
+           size_t _alphabet_size=20, size_t _max_duration=100, uint32_t _seed=1, size_t _id_period=0)
+      : num_categories(_num_categories), sequences_per_category(_sequences_per_category),
+        states_per_sequence(_states_per_sequence), alphabet_size(_alphabet_size),
+        max_duration(_max_duration), seed(_seed), id_period(_id_period)
+    { ; }
+  };
+
+protected:
+  Config config;
+  std::mt19937 rng;
+
+  /// Uniform value in [0, n).
+  uint32_t Random(size_t n) { return (uint32_t) (((uint64_t) rng() * (uint64_t) n) >> 32); }
+
+  /// Quote a CSV field if needed.
+  static std::string CSVField(const std::string & field) {
+    if (field.find_first_of(",\"\n") == std::string::npos) return field;
+    std::string out("\"");
+    for (char c : field) {
+      if (c == '"') out += '"';
+      out += c;
+    }
+    return out + "\"";
+  }
+
+public:
+  StateSequenceGenerator(const Config & _config=Config()) : config(_config), rng(_config.seed) { ; }
+
+  const Config & GetConfig() const { return config; }
+
+  /// Total number of states that Write will produce.
+  size_t GetNumStates() const {
+    return config.num_categories * config.sequences_per_category * config.states_per_sequence;
+  }
+
+  /// Write a CSV with the columns named in schema (plus a leading row number column, as in the
+  /// experiment output this tool mimics). Restarts the random number generator, so writing twice
+  /// produces identical files.
+  bool Write(std::ostream & os, const StateSequenceDataset::Schema & schema) {
+    rng.seed(config.seed);
+    const std::string & delim = schema.delim;
+    os << "x," << CSVField(schema.category) << "," << CSVField(schema.seqID) << ","
+       << CSVField(schema.states) << "," << CSVField(schema.starts) << "," << CSVField(schema.durations) << "\n";
+    std::string states_str, starts_str, durations_str;
+    size_t row = 0;
+    for (size_t seq = 0; seq < config.sequences_per_category; ++seq) {
+      // Interleave categories, so they are not contiguous in the file.
+      for (size_t cat = 0; cat < config.num_categories; ++cat) {
+        states_str.clear();
+        starts_str.clear();
+        durations_str.clear();
+        size_t time = Random(config.max_duration);
+        for (size_t i = 0; i < config.states_per_sequence; ++i) {
+          const size_t duration = 1 + Random(config.max_duration);
+          if (i > 0) {
+            states_str += delim;
+            starts_str += delim;
+            durations_str += delim;
+          }
+          states_str += "s" + std::to_string(Random(config.alphabet_size));
+          starts_str += std::to_string(time);
+          durations_str += std::to_string(duration);
+          time += duration;
+        }
+        const size_t id = config.id_period ? seq % config.id_period : seq;
+        os << row++ << ",T" << cat << "," << id << "," << CSVField(states_str) << ","
+           << CSVField(starts_str) << "," << CSVField(durations_str) << "\n";
+      }
+    }
+    return (bool) os;
+  }
+
+  bool Write(const std::string & filename, const StateSequenceDataset::Schema & schema) {
+    std::ofstream file(filename);
+    return file && Write(file, schema);
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef STATE_SEQUENCE_INTERVAL_INDEX_H
+#define STATE_SEQUENCE_INTERVAL_INDEX_H
+
+#include <algorithm>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+#include "StateSequenceDataset.h"
+
+namespace emp {
+
+/// Per-sequence sorted-start index over a StateSequenceDataset, used to find the states of a
+/// sequence that overlap a time window with two binary searches instead of a scan.
+/// For every state we keep the latest end of any state up to (and including) it in its sequence;
+/// these running ends are always sorted, and in a sequence whose states are ordered by start so
+/// are the starts. (Sequences not ordered by start are only trimmed at the front.)
+class StateSequenceIntervalIndex {
+public:
+  using index_t = StateSequenceDataset::index_t;
+
+  static constexpr size_t NO_STATE = (size_t) -1;   ///< Returned by FindStateAt when nothing is found.
+
+protected:
+  emp::vector<double> max_ends;   ///< Per state: latest end among states up to it in its sequence.
+  emp::vector<bool> sorted;       ///< Per sequence: are its states ordered by start?
+  emp::vector<index_t> begins;    ///< Per sequence: where its states were when they were indexed.
+  emp::vector<index_t> lengths;   ///< Per sequence: how many of its states have been indexed.
+
+  /// Index states [from, length) of sequence seq (states before from are indexed already).
+  void IndexStates(const StateSequenceDataset & data, size_t seq, size_t from) {
+    const auto & starts = data.GetStarts();
+    const auto & durations = data.GetDurations();
+    const size_t begin = data.GetSequenceBegins()[seq];
+    const size_t end = begin + data.GetSequenceLengths()[seq];
+    bool seq_sorted = (from == 0) || sorted[seq];
+    double max_end = (from == 0) ? 0.0 : max_ends[begin + from - 1];
+    for (size_t k = begin + from; k < end; ++k) {
+      const double state_end = starts[k] + durations[k];
+      max_end = (k == begin) ? state_end : std::max(max_end, state_end);
+      max_ends[k] = max_end;
+      if (k > begin && starts[k] < starts[k - 1]) seq_sorted = false;
+    }
+    sorted[seq] = seq_sorted;
+    begins[seq] = (index_t) begin;
+    lengths[seq] = (index_t) (end - begin);
+  }
+
+public:
+  StateSequenceIntervalIndex() : max_ends(), sorted(), begins(), lengths() { ; }
+
+  void Clear() {
+    max_ends.clear();
+    sorted.clear();
+    begins.clear();
+    lengths.clear();
+  }
+
+  /// Number of sequences indexed so far.
+  size_t GetNumSequences() const { return sorted.size(); }
+
+  /// Index every sequence added to data since the last update.
+  void Update(const StateSequenceDataset & data) {
+    max_ends.resize(data.GetNumStates());
+    const size_t first = sorted.size();
+    sorted.resize(data.GetNumSequences());
+    begins.resize(data.GetNumSequences());
+    lengths.resize(data.GetNumSequences());
+    for (size_t seq = first; seq < data.GetNumSequences(); ++seq) IndexStates(data, seq, 0);
+  }
+
+  /// Bring sequence seq up to date after it has been extended (see StateSequenceDataset::ExtendSequence):
+  /// only its new states are indexed, unless it has moved. (Call Update first for new sequences.)
+  void UpdateSequence(const StateSequenceDataset & data, size_t seq) {
+    emp_assert(seq < sorted.size(), seq, sorted.size());
+    max_ends.resize(data.GetNumStates());
+    const bool moved = (begins[seq] != data.GetSequenceBegins()[seq]);
+    IndexStates(data, seq, moved ? 0 : lengths[seq]);
+  }
+
+  /// Narrow [first, last) to the states of sequence seq that may overlap [y_min, y_max].
+  /// Every overlapping state is in the resulting range; callers still need to test each candidate
+  /// (a long state can keep earlier, shorter ones in range).
+  void FindCandidates(const StateSequenceDataset & data, size_t seq, double y_min, double y_max,
+                      size_t & first, size_t & last) const {
+    emp_assert(seq < sorted.size(), seq, sorted.size());
+    first = data.GetSequenceBegins()[seq];
+    last = first + data.GetSequenceLengths()[seq];
+    // Running ends never decrease, so states ending before y_min form a prefix of any sequence.
+    first = (size_t) (std::lower_bound(max_ends.data() + first, max_ends.data() + last, y_min) - max_ends.data());
+    if (!sorted[seq]) return;
+    const double * starts = data.GetStarts().data();
+    last = std::max(first, (size_t) (std::upper_bound(starts + first, starts + last, y_max) - starts));
+  }
+
+  /// Find the state of sequence seq in effect at time (the latest-starting one where states overlap).
+  /// Returns NO_STATE if the sequence has no state at time.
+  size_t FindStateAt(const StateSequenceDataset & data, size_t seq, double time) const {
+    size_t first = 0;
+    size_t last = 0;
+    FindCandidates(data, seq, time, time, first, last);
+    const double * starts = data.GetStarts().data();
+    size_t found = NO_STATE;
+    for (size_t k = last; k-- > first;) {
+      if (!Overlaps(data, k, time, time)) continue;
+      if (sorted[seq]) return k;
+      if (found == NO_STATE || starts[k] > starts[found]) found = k;
+    }
+    return found;
+  }
+
+  /// Does state k of data overlap [y_min, y_max]?
+  static bool Overlaps(const StateSequenceDataset & data, size_t k, double y_min, double y_max) {
+    const double start = data.GetStarts()[k];
+    return start <= y_max && start + data.GetDurations()[k] >= y_min;
+  }
+};
+
+}
+
+#endif
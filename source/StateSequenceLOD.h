@@ -0,0 +1,208 @@
+#ifndef STATE_SEQUENCE_LOD_H
+#define STATE_SEQUENCE_LOD_H
+
+#include <utility>
+#include <algorithm>
+#include <cmath>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+#include "StateSequenceDataset.h"
+#include "StateSequenceIntervalIndex.h"
+
+namespace emp {
+
+/// Level-of-detail summary of one category of a StateSequenceDataset.
+/// The visible part of the category is divided into a grid of (pixel sized) bins: columns group
+/// neighboring sequences, rows group time. Each bin is assigned its dominant state (the state
+/// covering the most sequence-time within it), and vertical runs of bins with the same dominant
+/// state are merged, so the number of elements needed to draw the summary is bounded by the grid
+/// size rather than by the amount of data.
+class StateSequenceLOD {
+public:
+  using code_t = StateSequenceDataset::code_t;
+  using index_t = StateSequenceDataset::index_t;
+
+  /// Part of a category to summarize, and the size of the grid to summarize it into.
+  struct Viewport {
+    size_t seq_begin;   ///< First sequence position (within the category) in view.
+    size_t seq_end;     ///< One past the last sequence position in view.
+    double y_min;       ///< Start of the visible time window.
+    double y_max;       ///< End of the visible time window.
+    size_t cols;        ///< Number of horizontal bins available (e.g., canvas width in pixels).
+    size_t rows;        ///< Number of vertical bins available (e.g., canvas height in pixels).
+
+    Viewport(size_t _seq_begin=0, size_t _seq_end=0, double _y_min=0.0, double _y_max=0.0,
+             size_t _cols=0, size_t _rows=0)
+      : seq_begin(_seq_begin), seq_end(_seq_end), y_min(_y_min), y_max(_y_max), cols(_cols), rows(_rows)
+    { ; }
+  };
+
+  static constexpr size_t RUN_FIELDS = 5;  ///< Each run is stored as x0, x1, y0, y1, state.
+
+protected:
+  Viewport viewport;
+  size_t num_cols;                 ///< Columns actually used (never more than sequences in view).
+  emp::vector<code_t> cells;       ///< Dominant state per bin (column-major); -1 for empty bins.
+  emp::vector<double> runs;        ///< Merged runs, RUN_FIELDS values each, in data units.
+
+  /// Scratch space: per-row (state, weight) accumulators for the column being built.
+  emp::vector<emp::vector<std::pair<code_t, double>>> row_weights;
+
+  static void AddWeight(emp::vector<std::pair<code_t, double>> & weights, code_t state, double weight) {
+    for (auto & entry : weights) {
+      if (entry.first == state) { entry.second += weight; return; }
+    }
+    weights.emplace_back(state, weight);
+  }
+
+  static code_t Dominant(const emp::vector<std::pair<code_t, double>> & weights) {
+    code_t best = -1;
+    double best_weight = 0.0;
+    for (const auto & entry : weights) {
+      if (entry.second > best_weight || (entry.second == best_weight && best != -1 && entry.first < best)) {
+        best = entry.first;
+        best_weight = entry.second;
+      }
+    }
+    return best;
+  }
+
+public:
+  StateSequenceLOD() : viewport(), num_cols(0), cells(), runs(), row_weights() { ; }
+
+  /// Would drawing every state in viewport be worthwhile? True if every sequence gets at least one
+  /// column, at most max_subpixel_fraction of the visible states are shorter than one row, and the
+  /// number of visible states fits in the grid. If index is given, only candidate states are visited.
+  static bool IsResolvable(const StateSequenceDataset & data, code_t cat, const Viewport & view,
+                           const StateSequenceIntervalIndex * index=nullptr, double max_subpixel_fraction=0.1) {
+    return IsResolvable(data, data.GetCategorySequences(cat), view, index, max_subpixel_fraction);
+  }
+
+  /// As above, for sequences seqs of data (in display order) rather than a category in file order.
+  static bool IsResolvable(const StateSequenceDataset & data, const emp::vector<index_t> & seqs, const Viewport & view,
+                           const StateSequenceIntervalIndex * index=nullptr, double max_subpixel_fraction=0.1) {
+    const size_t seq_end = std::min(view.seq_end, seqs.size());
+    if (view.seq_begin >= seq_end) return true;
+    if (seq_end - view.seq_begin > view.cols) return false;
+    const double extent = view.y_max - view.y_min;
+    const double row_size = (extent > 0.0 && view.rows > 0) ? extent / (double) view.rows : 1.0;
+    const size_t max_states = view.cols * view.rows;
+    const auto & begins = data.GetSequenceBegins();
+    const auto & lengths = data.GetSequenceLengths();
+    const auto & starts = data.GetStarts();
+    const auto & durations = data.GetDurations();
+    size_t visible = 0;
+    size_t subpixel = 0;
+    for (size_t pos = view.seq_begin; pos < seq_end; ++pos) {
+      const size_t seq = seqs[pos];
+      size_t first = begins[seq];
+      size_t end = first + lengths[seq];
+      if (index) index->FindCandidates(data, seq, view.y_min, view.y_max, first, end);
+      for (size_t k = first; k < end; ++k) {
+        const double lo = std::max(starts[k], view.y_min);
+        const double hi = std::min(starts[k] + durations[k], view.y_max);
+        if (hi < lo) continue;
+        if (++visible > max_states) return false;
+        if (hi - lo < row_size) ++subpixel;
+      }
+    }
+    return (double) subpixel <= max_subpixel_fraction * (double) visible;
+  }
+
+  /// Summarize category cat of data within view. If index is given, only candidate states are visited.
+  void Build(const StateSequenceDataset & data, code_t cat, const Viewport & view,
+             const StateSequenceIntervalIndex * index=nullptr) {
+    Build(data, data.GetCategorySequences(cat), view, index);
+  }
+
+  /// Summarize sequences seqs of data (in display order) within view.
+  void Build(const StateSequenceDataset & data, const emp::vector<index_t> & seqs, const Viewport & view,
+             const StateSequenceIntervalIndex * index=nullptr) {
+    viewport = view;
+    cells.clear();
+    runs.clear();
+    const size_t seq_end = std::min(view.seq_end, seqs.size());
+    const size_t seq_begin = std::min(view.seq_begin, seq_end);
+    const size_t num_seqs = seq_end - seq_begin;
+    const size_t num_rows = std::max<size_t>(1, view.rows);
+    num_cols = std::min(std::max<size_t>(1, view.cols), num_seqs);
+    viewport.seq_begin = seq_begin;
+    viewport.seq_end = seq_end;
+    viewport.rows = num_rows;
+    if (num_cols == 0) return;
+
+    const double extent = view.y_max - view.y_min;
+    const double row_size = (extent > 0.0) ? extent / (double) num_rows : 1.0;
+    const auto & begins = data.GetSequenceBegins();
+    const auto & lengths = data.GetSequenceLengths();
+    const auto & states = data.GetStates();
+    const auto & starts = data.GetStarts();
+    const auto & durations = data.GetDurations();
+
+    cells.resize(num_cols * num_rows, -1);
+    row_weights.resize(num_rows);
+    for (size_t col = 0; col < num_cols; ++col) {
+      const size_t col_begin = seq_begin + (num_seqs * col) / num_cols;
+      const size_t col_end = seq_begin + (num_seqs * (col + 1)) / num_cols;
+      for (auto & weights : row_weights) weights.clear();
+
+      // Spread each state's sequence-time over the rows it overlaps.
+      for (size_t pos = col_begin; pos < col_end; ++pos) {
+        const size_t seq = seqs[pos];
+        size_t first = begins[seq];
+        size_t end = first + lengths[seq];
+        if (index) index->FindCandidates(data, seq, view.y_min, view.y_max, first, end);
+        for (size_t k = first; k < end; ++k) {
+          const double lo = std::max(starts[k], view.y_min);
+          const double hi = std::min(starts[k] + durations[k], view.y_max);
+          if (!(hi > lo)) continue;
+          const size_t first_row = std::min(num_rows - 1, (size_t) ((lo - view.y_min) / row_size));
+          const size_t last_row = std::min(num_rows, (size_t) std::ceil((hi - view.y_min) / row_size));
+          for (size_t row = first_row; row < last_row; ++row) {
+            const double row_lo = view.y_min + row_size * (double) row;
+            const double overlap = std::min(hi, row_lo + row_size) - std::max(lo, row_lo);
+            if (overlap > 0.0) AddWeight(row_weights[row], states[k], overlap);
+          }
+        }
+      }
+
+      // Pick each bin's dominant state and merge vertical runs.
+      code_t * col_cells = cells.data() + col * num_rows;
+      size_t run_start = 0;
+      for (size_t row = 0; row <= num_rows; ++row) {
+        if (row < num_rows) col_cells[row] = Dominant(row_weights[row]);
+        if (row == num_rows || (row > 0 && col_cells[row] != col_cells[row - 1])) {
+          if (row > 0 && col_cells[row - 1] != -1) {
+            runs.insert(runs.end(), { (double) col_begin, (double) col_end,
+                                      view.y_min + row_size * (double) run_start,
+                                      view.y_min + row_size * (double) row,
+                                      (double) col_cells[row - 1] });
+          }
+          run_start = row;
+        }
+      }
+    }
+  }
+
+  const Viewport & GetViewport() const { return viewport; }
+  size_t GetNumCols() const { return num_cols; }
+  size_t GetNumRows() const { return viewport.rows; }
+
+  /// Dominant state of a bin (-1 if nothing in view falls into it).
+  code_t GetCell(size_t col, size_t row) const {
+    emp_assert(col < num_cols && row < viewport.rows, col, row);
+    return cells[col * viewport.rows + row];
+  }
+
+  size_t GetNumRuns() const { return runs.size() / RUN_FIELDS; }
+
+  /// Merged runs as a flat array of (x0, x1, y0, y1, state) in data units, where x is the sequence
+  /// position within the category and y is time.
+  const emp::vector<double> & GetRuns() const { return runs; }
+};
+
+}
+
+#endif
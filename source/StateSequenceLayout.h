@@ -0,0 +1,123 @@
+#ifndef STATE_SEQUENCE_LAYOUT_H
+#define STATE_SEQUENCE_LAYOUT_H
+
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "base/vector.h"
+
+#include "StateSequenceDataset.h"
+
+namespace emp {
+
+/// Geometry shared by every renderer of a state sequence view (the web visualization and the
+/// native StateSequenceRenderer): margins around the data area, the mapping from data units
+/// (x = sequence position, y = time) to canvas pixels, and axis ticks.
+class StateSequenceLayout {
+public:
+  /// Convenient structure to keep track of margins.
+  struct Margin {
+    double top;
+    double right;
+    double bottom;
+    double left;
+
+    Margin(double _top=10.0, double _right=10.0, double _bottom=10.0, double _left=50.0)
+      : top(_top), right(_right), bottom(_bottom), left(_left)
+    { ; }
+  };
+
+  /// Width of each sequence, in sequence positions (the sequence at position p spans [p, p + 0.9]).
+  static constexpr double SEQUENCE_WIDTH = 0.9;
+
+  /// Axis tick length, in pixels.
+  static constexpr double TICK_SIZE = 6.0;
+
+protected:
+  Margin margins;
+  double width;                        ///< Full width (including margins), in pixels.
+  double height;                       ///< Full height (including margins), in pixels.
+  StateSequenceDataset::Domain view;   ///< Region of data shown in the canvas.
+
+public:
+  StateSequenceLayout(double _width=0.0, double _height=0.0,
+                      const StateSequenceDataset::Domain & _view=StateSequenceDataset::Domain(),
+                      const Margin & _margins=Margin())
+    : margins(_margins), width(_width), height(_height), view(_view)
+  { ; }
+
+  const Margin & GetMargins() const { return margins; }
+  double GetWidth() const { return width; }
+  double GetHeight() const { return height; }
+  const StateSequenceDataset::Domain & GetView() const { return view; }
+
+  /// Size of the data area (the full size minus margins).
+  double GetCanvasWidth() const { return width - margins.left - margins.right; }
+  double GetCanvasHeight() const { return height - margins.top - margins.bottom; }
+
+  void SetSize(double w, double h) { width = w; height = h; }
+  void SetView(const StateSequenceDataset::Domain & _view) { view = _view; }
+  void SetMargins(const Margin & _margins) { margins = _margins; }
+
+  /// Pixels per sequence position and per unit of time. (Empty domains are treated as one unit wide.)
+  double GetXScale() const {
+    const double extent = view.x_max - view.x_min;
+    return GetCanvasWidth() / (extent != 0.0 ? extent : 1.0);
+  }
+  double GetYScale() const {
+    const double extent = view.y_max - view.y_min;
+    return GetCanvasHeight() / (extent != 0.0 ? extent : 1.0);
+  }
+
+  /// Map a sequence position / time to canvas pixels (relative to the data area's top left corner).
+  double X(double pos) const { return (pos - view.x_min) * GetXScale(); }
+  double Y(double time) const { return (time - view.y_min) * GetYScale(); }
+
+  /// Map canvas pixels back to a sequence position / time (the inverse of X and Y).
+  double Position(double x) const { return view.x_min + x / GetXScale(); }
+  double Time(double y) const { return view.y_min + y / GetYScale(); }
+
+  /// Tick values for a linear axis over [lo, hi], as chosen by d3.scale.linear().ticks(count).
+  static emp::vector<double> Ticks(double lo, double hi, size_t count=10) {
+    emp::vector<double> ticks;
+    if (hi < lo) std::swap(lo, hi);
+    const double step = TickStep(lo, hi, count);
+    if (!(step > 0.0) || !std::isfinite(step)) return ticks;
+    const double first = std::ceil(lo / step) * step;
+    const double last = std::floor(hi / step) * step + step * 0.5;
+    for (size_t i = 0; first + step * (double) i < last; ++i) ticks.push_back(first + step * (double) i);
+    return ticks;
+  }
+
+  /// Spacing between ticks over [lo, hi]: a power of ten times 1, 2 or 5 (as in d3).
+  static double TickStep(double lo, double hi, size_t count=10) {
+    const double span = hi - lo;
+    if (!(span > 0.0)) return 0.0;
+    double step = std::pow(10.0, std::floor(std::log10(span / (double) count)));
+    const double err = (double) count / span * step;
+    if (err <= 0.15) step *= 10.0;
+    else if (err <= 0.35) step *= 5.0;
+    else if (err <= 0.75) step *= 2.0;
+    return step;
+  }
+
+  /// Tick label for value on an axis with the given tick step (d3's default ",.Nf" format).
+  static std::string TickLabel(double value, double step) {
+    const int precision = std::max(0, (int) -std::floor(std::log10(step) + 0.01));
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.*f", precision, std::fabs(value) < step * 1e-9 ? 0.0 : value);
+    std::string digits(buffer);
+    // Group the integer part by thousands.
+    const size_t sign = (digits[0] == '-') ? 1 : 0;
+    size_t int_end = digits.find('.');
+    if (int_end == std::string::npos) int_end = digits.size();
+    for (size_t pos = int_end; pos > sign + 3; pos -= 3) digits.insert(pos - 3, ",");
+    return digits;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,433 @@
+#ifndef STATE_SEQUENCE_ORDERING_H
+#define STATE_SEQUENCE_ORDERING_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+#include "StateSequenceDataset.h"
+#include "ThreadPool.h"
+
+namespace emp {
+
+/// Similarity-based ordering of the sequences in a category of a StateSequenceDataset.
+/// Pairwise distances between a category's sequences are computed natively (optionally on a
+/// ThreadPool), the sequences are clustered hierarchically (average linkage), and the leaf order of
+/// the resulting tree is used as the category's display order, so similar sequences end up side by
+/// side. Orders are cached per category and recomputed only once the category grows.
+/// Distances are kept in a condensed matrix, so memory is quadratic in the category size. Past a
+/// budget of pairs (the web build has a fixed-size heap), only an evenly spaced sample of the
+/// category is clustered, and every other sequence is placed right after its nearest sample member.
+class StateSequenceOrdering {
+public:
+  using code_t = StateSequenceDataset::code_t;
+  using index_t = StateSequenceDataset::index_t;
+
+  /// Default budget of pairwise distances (4 bytes each) per category.
+  static constexpr size_t DEFAULT_MAX_PAIRS = (1 << 22);
+
+  /// How to measure the distance between two sequences:
+  ///   * EDIT: edit (Levenshtein) distance between their sequences of state codes.
+  ///   * TIME_WEIGHTED: L1 distance between their time-weighted state vectors (the total duration
+  ///     each sequence spends in each state).
+  enum class Metric { EDIT=0, TIME_WEIGHTED };
+
+  /// Bit-parallel edit distance (Myers/Hyyro): one sequence (the pattern) is encoded as one match
+  /// bitmask per state, and the edit distance matrix is then advanced 64 cells per word operation
+  /// for every state of the other sequence. Pattern setup is linear, so one pattern is best matched
+  /// against many texts.
+  class EditPattern {
+  protected:
+    using word_t = uint64_t;
+    static constexpr size_t WORD_BITS = 64;
+    static constexpr word_t HIGH_BIT = ((word_t) 1) << (WORD_BITS - 1);
+
+    size_t length;               ///< Number of states in the pattern.
+    size_t num_words;            ///< Words per column of the matrix.
+    emp::vector<word_t> peq;     ///< Per state code: bitmask of the pattern positions holding it.
+    emp::vector<code_t> symbols; ///< States with a non-zero bitmask (cleared on the next Set).
+    emp::vector<word_t> pv;      ///< Scratch: positive vertical deltas of the current column.
+    emp::vector<word_t> mv;      ///< Scratch: negative vertical deltas of the current column.
+
+    /// Advance one block of the current column given the horizontal delta (-1, 0 or +1) entering
+    /// it from above; returns the horizontal delta leaving it at bit out_bit.
+    static int AdvanceBlock(word_t & pv_block, word_t & mv_block, word_t eq, int hin, word_t out_bit) {
+      const word_t hin_neg = (hin < 0) ? 1 : 0;
+      const word_t xv = eq | mv_block;
+      eq |= hin_neg;
+      const word_t xh = (((eq & pv_block) + pv_block) ^ pv_block) | eq;
+      word_t ph = mv_block | ~(xh | pv_block);
+      word_t mh = pv_block & xh;
+      const int hout = ((ph & out_bit) ? 1 : 0) - ((mh & out_bit) ? 1 : 0);
+      ph = (ph << 1) | ((hin > 0) ? 1 : 0);
+      mh = (mh << 1) | hin_neg;
+      pv_block = mh | ~(xv | ph);
+      mv_block = ph & xv;
+      return hout;
+    }
+
+  public:
+    EditPattern() : length(0), num_words(0), peq(), symbols(), pv(), mv() { ; }
+
+    size_t GetLength() const { return length; }
+
+    /// Use states [pattern, pattern + size) as the pattern. State codes must be below alphabet_size.
+    void Set(const code_t * pattern, size_t size, size_t alphabet_size) {
+      for (code_t state : symbols) {
+        std::fill(peq.begin() + (long) ((size_t) state * num_words),
+                  peq.begin() + (long) ((size_t) (state + 1) * num_words), 0);
+      }
+      symbols.clear();
+      length = size;
+      num_words = std::max<size_t>(1, (size + WORD_BITS - 1) / WORD_BITS);
+      if (peq.size() != alphabet_size * num_words) peq.assign(alphabet_size * num_words, 0);
+      for (size_t i = 0; i < size; ++i) {
+        emp_assert(pattern[i] >= 0 && (size_t) pattern[i] < alphabet_size, pattern[i], alphabet_size);
+        word_t & bits = peq[(size_t) pattern[i] * num_words + i / WORD_BITS];
+        if (bits == 0) symbols.push_back(pattern[i]);
+        bits |= ((word_t) 1) << (i % WORD_BITS);
+      }
+      pv.resize(num_words);
+      mv.resize(num_words);
+    }
+
+    /// Edit distance between the pattern and states [text, text + size).
+    size_t Distance(const code_t * text, size_t size) {
+      if (length == 0) return size;
+      std::fill(pv.begin(), pv.end(), ~((word_t) 0));
+      std::fill(mv.begin(), mv.end(), 0);
+      const word_t last_bit = ((word_t) 1) << ((length - 1) % WORD_BITS);
+      const size_t last_word = num_words - 1;
+      long score = (long) length;
+      for (size_t j = 0; j < size; ++j) {
+        const word_t * eq = peq.data() + (size_t) text[j] * num_words;
+        int h = 1;  // Distances along the top row grow by one per text state.
+        for (size_t w = 0; w < last_word; ++w) h = AdvanceBlock(pv[w], mv[w], eq[w], h, HIGH_BIT);
+        score += AdvanceBlock(pv[last_word], mv[last_word], eq[last_word], h, last_bit);
+      }
+      return (size_t) score;
+    }
+  };
+
+protected:
+  /// Cached order of one category.
+  struct Entry {
+    bool valid;
+    Metric metric;
+    size_t num_seqs;                ///< Category size the order was computed for.
+    emp::vector<index_t> order;     ///< Sequence indices in display order.
+
+    Entry() : valid(false), metric(Metric::EDIT), num_seqs(0), order() { ; }
+  };
+
+  Metric metric;
+  size_t max_pairs;             ///< Largest distance matrix (in pairs) to compute for one category.
+  emp::vector<Entry> entries;   ///< Per category code.
+
+  /// Index of pair (i, j), i < j, in a condensed distance matrix over n items.
+  static size_t PairIndex(size_t i, size_t j, size_t n) {
+    emp_assert(i < j && j < n, i, j, n);
+    return i * n - (i * (i + 1)) / 2 + (j - i - 1);
+  }
+
+  /// L1 distance between two vectors of size (a multiple of 8) floats. Eight independent partial
+  /// sums keep the loop vectorizable without reassociating floating point math.
+  static float L1Distance(const float * a, const float * b, size_t size) {
+    float sums[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < size; i += 8) {
+      for (size_t lane = 0; lane < 8; ++lane) sums[lane] += std::fabs(a[i + lane] - b[i + lane]);
+    }
+    return ((sums[0] + sums[1]) + (sums[2] + sums[3])) + ((sums[4] + sums[5]) + (sums[6] + sums[7]));
+  }
+
+  /// Time-weighted state vectors of sequences seqs of data, stride floats apart.
+  static void ComputeWeights(const StateSequenceDataset & data, const emp::vector<index_t> & seqs,
+                             size_t stride, emp::vector<float> & weights) {
+    const auto & begins = data.GetSequenceBegins();
+    const auto & lengths = data.GetSequenceLengths();
+    const auto & states = data.GetStates();
+    const auto & durations = data.GetDurations();
+    weights.assign(seqs.size() * stride, 0.0f);
+    for (size_t i = 0; i < seqs.size(); ++i) {
+      const size_t seq = seqs[i];
+      for (size_t k = begins[seq]; k < begins[seq] + lengths[seq]; ++k) {
+        weights[i * stride + (size_t) states[k]] += (float) durations[k];
+      }
+    }
+  }
+
+  /// Vector stride (the number of states, padded to a multiple of 8) for time-weighted distances.
+  static size_t GetWeightStride(const StateSequenceDataset & data) {
+    return ((data.GetStateNames().size() + 7) / 8) * 8;
+  }
+
+public:
+  StateSequenceOrdering(Metric _metric=Metric::EDIT, size_t _max_pairs=DEFAULT_MAX_PAIRS)
+    : metric(_metric), max_pairs(_max_pairs), entries() { ; }
+
+  Metric GetMetric() const { return metric; }
+  size_t GetMaxPairs() const { return max_pairs; }
+
+  /// Set the metric used for orders computed from now on (cached orders are recomputed on use).
+  void SetMetric(Metric _metric) { metric = _metric; }
+
+  /// Set the budget of pairwise distances per category (cached orders are recomputed on use).
+  void SetMaxPairs(size_t _max_pairs) {
+    if (_max_pairs != max_pairs) entries.clear();
+    max_pairs = _max_pairs;
+  }
+
+  /// Largest number of items (at least 2) whose condensed distance matrix fits in max_pairs pairs.
+  static size_t GetMaxItems(size_t max_pairs) {
+    size_t items = (size_t) ((1.0 + std::sqrt(1.0 + 8.0 * (double) max_pairs)) / 2.0);
+    while (items > 2 && items * (items - 1) / 2 > max_pairs) --items;
+    while (items * (items + 1) / 2 <= max_pairs) ++items;
+    return std::max<size_t>(2, items);
+  }
+
+  /// Forget every cached order (e.g., when the dataset is replaced).
+  void Clear() { entries.clear(); }
+
+  /// Forget the order of category cat (e.g., when some of its sequences have been extended).
+  void Invalidate(code_t cat) {
+    if ((size_t) cat < entries.size()) entries[(size_t) cat].valid = false;
+  }
+
+  /// Pairwise distances between sequences seqs of data, as a condensed matrix (see PairIndex).
+  /// Rows are spread over pool if one is given.
+  static void ComputeDistances(const StateSequenceDataset & data, const emp::vector<index_t> & seqs,
+                               Metric metric, emp::vector<float> & dist, ThreadPool * pool=nullptr) {
+    const size_t n = seqs.size();
+    dist.resize(n < 2 ? 0 : (n * (n - 1)) / 2);
+    if (n < 2) return;
+    const auto & begins = data.GetSequenceBegins();
+    const auto & lengths = data.GetSequenceLengths();
+    const code_t * states = data.GetStates().data();
+    const size_t alphabet_size = data.GetStateNames().size();
+
+    const size_t stride = GetWeightStride(data);
+    emp::vector<float> weights;
+    if (metric == Metric::TIME_WEIGHTED) ComputeWeights(data, seqs, stride, weights);
+
+    // Row i holds the distances from sequence i to every later one.
+    auto FillRow = [&](size_t i) {
+      float * row = dist.data() + PairIndex(i, i + 1, n);
+      if (metric == Metric::TIME_WEIGHTED) {
+        for (size_t j = i + 1; j < n; ++j) {
+          row[j - i - 1] = L1Distance(weights.data() + i * stride, weights.data() + j * stride, stride);
+        }
+        return;
+      }
+      EditPattern pattern;
+      pattern.Set(states + begins[seqs[i]], lengths[seqs[i]], alphabet_size);
+      for (size_t j = i + 1; j < n; ++j) {
+        row[j - i - 1] = (float) pattern.Distance(states + begins[seqs[j]], lengths[seqs[j]]);
+      }
+    };
+    if (pool) {
+      pool->ParallelFor(n - 1, FillRow);
+    } else {
+      for (size_t i = 0; i + 1 < n; ++i) FillRow(i);
+    }
+  }
+
+  /// Leaf order of the average-linkage clustering of n items with condensed distance matrix dist
+  /// (which is overwritten). Clusters are merged with the nearest-neighbor chain algorithm (quadratic
+  /// time); the children of every merge are listed by their earliest item, so ties keep input order.
+  static void ClusterOrder(emp::vector<float> & dist, size_t n, emp::vector<size_t> & order) {
+    order.clear();
+    if (n < 3) {
+      for (size_t i = 0; i < n; ++i) order.push_back(i);
+      return;
+    }
+    auto D = [&dist, n](size_t a, size_t b) -> float & {
+      return (a < b) ? dist[PairIndex(a, b, n)] : dist[PairIndex(b, a, n)];
+    };
+    // Tree nodes: items are leaves 0..n-1; merges add nodes n..2n-2.
+    emp::vector<size_t> first_child(2 * n - 1, 0);
+    emp::vector<size_t> second_child(2 * n - 1, 0);
+    emp::vector<size_t> min_item(2 * n - 1, 0);
+    for (size_t i = 0; i < n; ++i) min_item[i] = i;
+    emp::vector<size_t> node(n);       // Tree node held by each matrix slot.
+    emp::vector<size_t> size(n, 1);    // Items in each slot's cluster.
+    emp::vector<bool> active(n, true);
+    for (size_t i = 0; i < n; ++i) node[i] = i;
+
+    emp::vector<size_t> chain;
+    size_t next_node = n;
+    size_t first_active = 0;
+    while (next_node < 2 * n - 1) {
+      if (chain.empty()) {
+        while (!active[first_active]) ++first_active;
+        chain.push_back(first_active);
+      }
+      const size_t a = chain.back();
+      const bool has_prev = chain.size() >= 2;
+      size_t b = has_prev ? chain[chain.size() - 2] : a;
+      float best = has_prev ? D(a, b) : std::numeric_limits<float>::infinity();
+      for (size_t k = 0; k < n; ++k) {
+        if (k == a || !active[k]) continue;
+        const float d = D(a, k);
+        if (d < best || b == a) {
+          best = d;
+          b = k;
+        }
+      }
+      if (!has_prev || b != chain[chain.size() - 2]) {
+        chain.push_back(b);
+        continue;
+      }
+
+      // a and b are reciprocal nearest neighbors: merge them into the lower slot.
+      chain.pop_back();
+      chain.pop_back();
+      const size_t keep = std::min(a, b);
+      const size_t drop = std::max(a, b);
+      const double keep_size = (double) size[keep];
+      const double drop_size = (double) size[drop];
+      for (size_t k = 0; k < n; ++k) {
+        if (k == keep || k == drop || !active[k]) continue;
+        D(keep, k) = (float) ((keep_size * D(keep, k) + drop_size * D(drop, k)) / (keep_size + drop_size));
+      }
+      const bool keep_first = min_item[node[keep]] < min_item[node[drop]];
+      first_child[next_node] = keep_first ? node[keep] : node[drop];
+      second_child[next_node] = keep_first ? node[drop] : node[keep];
+      min_item[next_node] = std::min(min_item[node[keep]], min_item[node[drop]]);
+      node[keep] = next_node++;
+      size[keep] += size[drop];
+      active[drop] = false;
+    }
+
+    // Depth-first walk from the root, first children first.
+    emp::vector<size_t> stack(1, 2 * n - 2);
+    while (!stack.empty()) {
+      const size_t cur = stack.back();
+      stack.pop_back();
+      if (cur < n) {
+        order.push_back(cur);
+      } else {
+        stack.push_back(second_child[cur]);
+        stack.push_back(first_child[cur]);
+      }
+    }
+  }
+
+  /// For each of sequences seqs of data, the position in items (other sequences) of its nearest one
+  /// (the first, on ties). Sequences are spread over pool if one is given.
+  static void ComputeNearest(const StateSequenceDataset & data, const emp::vector<index_t> & seqs,
+                             const emp::vector<index_t> & items, Metric metric, emp::vector<size_t> & nearest,
+                             ThreadPool * pool=nullptr) {
+    emp_assert(items.size() > 0);
+    nearest.assign(seqs.size(), 0);
+    const auto & begins = data.GetSequenceBegins();
+    const auto & lengths = data.GetSequenceLengths();
+    const code_t * states = data.GetStates().data();
+    const size_t alphabet_size = data.GetStateNames().size();
+
+    const size_t stride = GetWeightStride(data);
+    emp::vector<float> item_weights;
+    if (metric == Metric::TIME_WEIGHTED) ComputeWeights(data, items, stride, item_weights);
+
+    auto FindNearest = [&](size_t i) {
+      float best = std::numeric_limits<float>::infinity();
+      if (metric == Metric::TIME_WEIGHTED) {
+        emp::vector<float> weights;
+        ComputeWeights(data, emp::vector<index_t>(1, seqs[i]), stride, weights);
+        for (size_t j = 0; j < items.size(); ++j) {
+          const float d = L1Distance(weights.data(), item_weights.data() + j * stride, stride);
+          if (d < best) { best = d; nearest[i] = j; }
+        }
+        return;
+      }
+      EditPattern pattern;
+      pattern.Set(states + begins[seqs[i]], lengths[seqs[i]], alphabet_size);
+      for (size_t j = 0; j < items.size(); ++j) {
+        const float d = (float) pattern.Distance(states + begins[items[j]], lengths[items[j]]);
+        if (d < best) { best = d; nearest[i] = j; }
+      }
+    };
+    if (pool) {
+      pool->ParallelFor(seqs.size(), FindNearest);
+    } else {
+      for (size_t i = 0; i < seqs.size(); ++i) FindNearest(i);
+    }
+  }
+
+  /// Compute the similarity order of sequences seqs of data: the same indices, rearranged. If their
+  /// distance matrix would exceed max_pairs, an evenly spaced sample of them is clustered instead,
+  /// and each other sequence follows its nearest sample member (in input order).
+  static void ComputeOrder(const StateSequenceDataset & data, const emp::vector<index_t> & seqs, Metric metric,
+                           emp::vector<index_t> & out, ThreadPool * pool=nullptr,
+                           size_t max_pairs=DEFAULT_MAX_PAIRS) {
+    const size_t n = seqs.size();
+    const size_t num_samples = GetMaxItems(max_pairs);
+    emp::vector<float> dist;
+    emp::vector<size_t> leaves;
+    out.resize(n);
+    if (n <= num_samples) {
+      ComputeDistances(data, seqs, metric, dist, pool);
+      ClusterOrder(dist, n, leaves);
+      for (size_t pos = 0; pos < leaves.size(); ++pos) out[pos] = seqs[leaves[pos]];
+      return;
+    }
+
+    emp::vector<index_t> sample(num_samples);
+    emp::vector<index_t> rest;
+    for (size_t s = 0, pos = 0; pos < n; ++pos) {
+      if (s < num_samples && pos == s * n / num_samples) sample[s++] = seqs[pos];
+      else rest.push_back(seqs[pos]);
+    }
+    ComputeDistances(data, sample, metric, dist, pool);
+    ClusterOrder(dist, num_samples, leaves);
+    dist = emp::vector<float>();
+
+    // Group the rest by nearest sample member (counting sort keeps input order within a group).
+    emp::vector<size_t> nearest;
+    ComputeNearest(data, rest, sample, metric, nearest, pool);
+    emp::vector<size_t> group_begin(num_samples + 1, 0);
+    for (size_t j : nearest) ++group_begin[j + 1];
+    for (size_t s = 0; s < num_samples; ++s) group_begin[s + 1] += group_begin[s];
+    emp::vector<index_t> grouped(rest.size());
+    emp::vector<size_t> fill(group_begin.begin(), group_begin.end() - 1);
+    for (size_t i = 0; i < rest.size(); ++i) grouped[fill[nearest[i]]++] = rest[i];
+
+    size_t pos = 0;
+    for (size_t leaf : leaves) {
+      out[pos++] = sample[leaf];
+      for (size_t k = group_begin[leaf]; k < group_begin[leaf + 1]; ++k) out[pos++] = grouped[k];
+    }
+    emp_assert(pos == n, pos, n);
+  }
+
+  /// Get the similarity order of category cat of data (sequence indices, as in
+  /// StateSequenceDataset::GetCategorySequences). Computed on first use, and again whenever the
+  /// category has grown or the metric has changed since.
+  const emp::vector<index_t> & Get(const StateSequenceDataset & data, code_t cat, ThreadPool * pool=nullptr) {
+    emp_assert(cat >= 0 && (size_t) cat < data.GetNumCategories(), cat, data.GetNumCategories());
+    if (entries.size() < data.GetNumCategories()) entries.resize(data.GetNumCategories());
+    Entry & entry = entries[(size_t) cat];
+    const auto & seqs = data.GetCategorySequences(cat);
+    if (!entry.valid || entry.metric != metric || entry.num_seqs != seqs.size()) {
+      ComputeOrder(data, seqs, metric, entry.order, pool, max_pairs);
+      entry.valid = true;
+      entry.metric = metric;
+      entry.num_seqs = seqs.size();
+    }
+    return entry.order;
+  }
+
+  /// Has the current order of category cat already been computed?
+  bool IsCached(const StateSequenceDataset & data, code_t cat) const {
+    if (cat < 0 || (size_t) cat >= entries.size()) return false;
+    const Entry & entry = entries[(size_t) cat];
+    return entry.valid && entry.metric == metric && entry.num_seqs == data.GetCategorySequences(cat).size();
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef STATE_SEQUENCE_PARALLEL_CSV_H
+#define STATE_SEQUENCE_PARALLEL_CSV_H
+
+#include <string>
+#include <algorithm>
+#include <cstring>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+#include "MappedFile.h"
+#include "StateSequenceCSVStream.h"
+#include "StateSequenceDataset.h"
+#include "StateSequenceDecompressor.h"
+#include "ThreadPool.h"
+
+namespace emp {
+
+/// Native multithreaded CSV ingest for very large state sequence files.
+/// The file is split into newline-aligned chunks that are parsed and dictionary-encoded
+/// independently on a thread pool; the per-chunk dictionaries, domains and per-category sequence
+/// ID tables are then merged in file order, so the result is identical to a single-threaded
+/// StateSequenceDataset::LoadCSV. (As with LoadCSV, records may not contain quoted newlines.)
+class StateSequenceParallelCSVLoader {
+public:
+  using code_t = StateSequenceDataset::code_t;
+  using index_t = StateSequenceDataset::index_t;
+
+protected:
+  /// One newline-aligned slice of the input and everything parsed from it.
+  struct Chunk {
+    const char * begin;
+    const char * end;
+    size_t first_line;               ///< Line number of the first record in this chunk.
+    StateSequenceDataset part;       ///< Sequences parsed from this chunk (chunk-local codes).
+    bool ok;
+    size_t state_offset;             ///< Where this chunk's states land in the merged columns.
+    size_t seq_offset;               ///< Where this chunk's sequences land in the merged columns.
+    emp::vector<code_t> state_map;   ///< Chunk-local state code -> merged code.
+    emp::vector<code_t> category_map;
+    emp::vector<code_t> id_map;
+
+    Chunk(const char * _begin, const char * _end)
+      : begin(_begin), end(_end), first_line(0), part(), ok(false), state_offset(0), seq_offset(0),
+        state_map(), category_map(), id_map()
+    { ; }
+  };
+
+  ThreadPool pool;
+  size_t min_chunk_size;
+  std::string error;
+
+  static size_t CountLines(const char * begin, const char * end) {
+    size_t count = 0;
+    while (begin < end) {
+      const void * found = std::memchr(begin, '\n', (size_t) (end - begin));
+      if (found == nullptr) return count + 1;
+      ++count;
+      begin = static_cast<const char *>(found) + 1;
+    }
+    return count;
+  }
+
+  /// Build chunk-local -> merged code tables and fold chunk's domains, ID tables and category
+  /// index into out. Must be called on chunks in file order (with seq_offset already set) so codes
+  /// keep first-appearance order.
+  static void MergeDictionaries(Chunk & chunk, StateSequenceDataset & out) {
+    const StateSequenceDataset & part = chunk.part;
+    chunk.state_map.resize(part.state_dict.size());
+    for (size_t i = 0; i < part.state_dict.size(); ++i) {
+      chunk.state_map[i] = out.state_dict.Insert(part.state_dict[(code_t) i]);
+    }
+    chunk.id_map.resize(part.seqID_dict.size());
+    for (size_t i = 0; i < part.seqID_dict.size(); ++i) {
+      chunk.id_map[i] = out.seqID_dict.Insert(part.seqID_dict[(code_t) i]);
+    }
+    chunk.category_map.resize(part.category_dict.size());
+    for (size_t i = 0; i < part.category_dict.size(); ++i) {
+      const code_t cat = out.category_dict.Insert(part.category_dict[(code_t) i]);
+      chunk.category_map[i] = cat;
+      const StateSequenceDataset::Domain & domain = part.domains[i];
+      if ((size_t) cat == out.domains.size()) {
+        out.domains.push_back(domain);
+        out.category_ids.emplace_back();
+        out.category_seqs.emplace_back();
+      } else {
+        StateSequenceDataset::Domain & merged = out.domains[(size_t) cat];
+        merged.x_max += domain.x_max;
+        merged.y_min = std::min(merged.y_min, domain.y_min);
+        merged.y_max = std::max(merged.y_max, domain.y_max);
+      }
+      for (index_t s : part.category_seqs[i]) {
+        out.category_seqs[(size_t) cat].push_back((index_t) (s + chunk.seq_offset));
+      }
+      for (code_t id : part.category_ids[i]) {
+        const code_t merged_id = chunk.id_map[(size_t) id];
+        if (out.category_id_set.insert(StateSequenceDataset::CategoryIDKey(cat, merged_id)).second) {
+          out.category_ids[(size_t) cat].push_back(merged_id);
+        }
+      }
+    }
+  }
+
+  /// Copy chunk's columns into their slot in out, translating codes.
+  static void CopyColumns(const Chunk & chunk, StateSequenceDataset & out) {
+    const StateSequenceDataset & part = chunk.part;
+    for (size_t i = 0; i < part.states.size(); ++i) {
+      out.states[chunk.state_offset + i] = chunk.state_map[(size_t) part.states[i]];
+    }
+    std::copy(part.starts.begin(), part.starts.end(), out.starts.begin() + chunk.state_offset);
+    std::copy(part.durations.begin(), part.durations.end(), out.durations.begin() + chunk.state_offset);
+    for (size_t s = 0; s < part.seq_begins.size(); ++s) {
+      const size_t dest = chunk.seq_offset + s;
+      out.seq_begins[dest] = (index_t) (part.seq_begins[s] + chunk.state_offset);
+      out.seq_lengths[dest] = part.seq_lengths[s];
+      out.seq_categories[dest] = chunk.category_map[(size_t) part.seq_categories[s]];
+      out.seq_ids[dest] = chunk.id_map[(size_t) part.seq_ids[s]];
+    }
+  }
+
+public:
+  /// num_threads = 0 uses one thread per hardware thread. Inputs smaller than
+  /// num_threads * _min_chunk_size are split into fewer chunks.
+  StateSequenceParallelCSVLoader(size_t num_threads=0, size_t _min_chunk_size=(1 << 20))
+    : pool(num_threads), min_chunk_size(std::max<size_t>(1, _min_chunk_size)), error()
+  { ; }
+
+  size_t GetNumThreads() const { return pool.GetNumThreads(); }
+
+  /// The loader's worker threads (e.g., to compute StateSequenceStatistics on the loaded data).
+  ThreadPool & GetThreadPool() { return pool; }
+  const std::string & GetError() const { return error; }
+
+  /// Load CSV data from an in-memory buffer into out (replacing its contents).
+  bool Load(const char * text, size_t size, const StateSequenceDataset::Schema & schema,
+            StateSequenceDataset & out) {
+    out.Clear();
+    error.clear();
+    if (size == 0) {
+      error = "CSV data is empty.";
+      return false;
+    }
+    const char * end = text + size;
+    const char * body = static_cast<const char *>(std::memchr(text, '\n', size));
+    body = (body == nullptr) ? end : body + 1;
+    StateSequenceDataset::CSVColumns cols(schema);
+    if (!out.ParseCSVHeader(text, body == end ? end : body - 1, cols)) {
+      error = out.GetError();
+      return false;
+    }
+
+    // Split the body into newline-aligned chunks.
+    const size_t body_size = (size_t) (end - body);
+    const size_t num_chunks = std::max<size_t>(1, std::min(pool.GetNumThreads() * 4, body_size / min_chunk_size));
+    emp::vector<Chunk> chunks;
+    chunks.reserve(num_chunks);
+    const char * chunk_begin = body;
+    for (size_t i = 1; i <= num_chunks && chunk_begin < end; ++i) {
+      const char * chunk_end = (i == num_chunks) ? end : body + (body_size * i) / num_chunks;
+      if (chunk_end < chunk_begin) chunk_end = chunk_begin;
+      const void * newline = std::memchr(chunk_end, '\n', (size_t) (end - chunk_end));
+      chunk_end = (newline == nullptr) ? end : static_cast<const char *>(newline) + 1;
+      chunks.emplace_back(chunk_begin, chunk_end);
+      chunk_begin = chunk_end;
+    }
+
+    // Line numbers are needed for error messages; counting newlines is far cheaper than parsing.
+    emp::vector<size_t> line_counts(chunks.size());
+    pool.ParallelFor(chunks.size(), [&chunks, &line_counts](size_t i) {
+      line_counts[i] = CountLines(chunks[i].begin, chunks[i].end);
+    });
+    size_t next_line = 2;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      chunks[i].first_line = next_line;
+      next_line += line_counts[i];
+    }
+
+    // Parse and dictionary-encode every chunk independently.
+    pool.ParallelFor(chunks.size(), [&chunks, &cols](size_t i) {
+      Chunk & chunk = chunks[i];
+      chunk.ok = chunk.part.AppendCSVRecords(chunk.begin, chunk.end, cols, chunk.first_line);
+    });
+    for (const Chunk & chunk : chunks) {
+      if (!chunk.ok) {
+        error = chunk.part.GetError();
+        out.Clear();
+        return false;
+      }
+    }
+
+    // Merge dictionaries in file order, then copy columns in parallel.
+    size_t num_states = 0;
+    size_t num_seqs = 0;
+    for (Chunk & chunk : chunks) {
+      chunk.state_offset = num_states;
+      chunk.seq_offset = num_seqs;
+      MergeDictionaries(chunk, out);
+      num_states += chunk.part.GetNumStates();
+      num_seqs += chunk.part.GetNumSequences();
+    }
+    emp_assert(num_states <= (size_t) UINT32_MAX, "Too many states for index_t.");
+    out.states.resize(num_states);
+    out.starts.resize(num_states);
+    out.durations.resize(num_states);
+    out.seq_begins.resize(num_seqs);
+    out.seq_lengths.resize(num_seqs);
+    out.seq_categories.resize(num_seqs);
+    out.seq_ids.resize(num_seqs);
+    pool.ParallelFor(chunks.size(), [&chunks, &out](size_t i) {
+      CopyColumns(chunks[i], out);
+      chunks[i].part = StateSequenceDataset();  // Release chunk memory as we go.
+    });
+    return true;
+  }
+
+  /// Memory-map filename and load its CSV data into out (replacing its contents).
+  /// Compressed files cannot be split up before they are decompressed; they are streamed through
+  /// the decompressor and parsed on the calling thread instead.
+  bool Load(const std::string & filename, const StateSequenceDataset::Schema & schema,
+            StateSequenceDataset & out) {
+    MappedFile file;
+    if (!file.Open(filename)) {
+      out.Clear();
+      error = "Unable to map file '" + filename + "'.";
+      return false;
+    }
+    const char * text = static_cast<const char *>(file.GetData());
+    if (StateSequenceDecompressor::Detect(text, file.GetSize()) != StateSequenceDecompressor::Format::PLAIN) {
+      StateSequenceCSVStream stream(schema);
+      out.Clear();
+      if (!stream.Feed(out, text, file.GetSize()) || !stream.Finish(out)) {
+        error = stream.GetError();
+        return false;
+      }
+      return true;
+    }
+    return Load(text, file.GetSize(), schema, out);
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef STATE_SEQUENCE_PROFILER_H
+#define STATE_SEQUENCE_PROFILER_H
+
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#if defined(__EMSCRIPTEN__) || defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/// Phase instrumentation is compiled in only when STATE_SEQ_VIS_PROFILE is defined (e.g., with
+/// -DSTATE_SEQ_VIS_PROFILE). Code wrapped in STATE_SEQ_PROFILE(...) disappears otherwise.
+#ifdef STATE_SEQ_VIS_PROFILE
+#define STATE_SEQ_PROFILE(...) __VA_ARGS__
+#else
+#define STATE_SEQ_PROFILE(...)
+#endif
+
+namespace emp {
+
+/// Per-phase statistics for loading and drawing state sequence data: how often each phase ran,
+/// how long it took (wall time), how many rows (sequences) and elements (states, drawn elements)
+/// it handled, and how much memory the dataset (and the whole heap) held afterwards.
+class StateSequenceProfiler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// Is instrumentation compiled in?
+#ifdef STATE_SEQ_VIS_PROFILE
+  static constexpr bool ENABLED = true;
+#else
+  static constexpr bool ENABLED = false;
+#endif
+
+  /// Phases of getting data on screen:
+  ///   * FETCH: downloading the data file (wall time until the whole file is in the heap; for
+  ///     streaming loads, until the last chunk arrived). Elements are bytes (lines when streaming).
+  ///   * PARSE: turning CSV text or a binary buffer into the native dataset.
+  ///   * EXPORT: handing newly parsed columns over to the JS renderer.
+  ///   * DRAW: drawing the current view.
+  ///   * RESIZE: re-laying out the view for a new size.
+  enum class Phase { FETCH=0, PARSE, EXPORT, DRAW, RESIZE };
+  static constexpr size_t NUM_PHASES = 5;
+
+  struct Stats {
+    size_t count;         ///< Number of times the phase ran.
+    double total_time;    ///< Total wall time (seconds).
+    double last_time;     ///< Wall time of the most recent run (seconds).
+    double max_time;      ///< Longest run (seconds).
+    size_t rows;          ///< Rows (sequences) handled by the most recent run.
+    size_t elements;      ///< Elements (states or drawn elements) handled by the most recent run.
+    size_t memory;        ///< Dataset memory (bytes) after the most recent run.
+    size_t heap_used;     ///< Heap bytes allocated (in use, not just reserved) after the most recent run.
+
+    Stats()
+      : count(0), total_time(0.0), last_time(0.0), max_time(0.0), rows(0), elements(0), memory(0), heap_used(0)
+    { ; }
+  };
+
+  /// Measures the wall time since its construction.
+  class Timer {
+  protected:
+    Phase phase;
+    Clock::time_point start;
+
+  public:
+    Timer(Phase _phase) : phase(_phase), start(Clock::now()) { ; }
+
+    Phase GetPhase() const { return phase; }
+
+    double GetSeconds() const {
+      return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+  };
+
+protected:
+  Stats stats[NUM_PHASES];
+
+public:
+  StateSequenceProfiler() : stats() { ; }
+
+  static const char * GetPhaseName(Phase phase) {
+    static const char * names[NUM_PHASES] = { "fetch", "parse", "export", "draw", "resize" };
+    return names[(size_t) phase];
+  }
+
+  const Stats & GetStats(Phase phase) const { return stats[(size_t) phase]; }
+
+  /// Bytes currently allocated by malloc (0 where the allocator can't tell us). glibc counts large
+  /// (mmapped) blocks separately; Emscripten's heap is a single sbrk'd region.
+  static size_t GetHeapUsage() {
+#if defined(__EMSCRIPTEN__)
+    return (size_t) mallinfo().uordblks;
+#elif defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    const auto info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+    const auto info = mallinfo();
+    return (size_t) info.uordblks + (size_t) info.hblkhd;
+#else
+    return 0;
+#endif
+  }
+
+  /// Record one run of phase.
+  void Record(Phase phase, double seconds, size_t rows, size_t elements, size_t memory) {
+    Stats & s = stats[(size_t) phase];
+    ++s.count;
+    s.total_time += seconds;
+    s.last_time = seconds;
+    s.max_time = std::max(s.max_time, seconds);
+    s.rows = rows;
+    s.elements = elements;
+    s.memory = memory;
+    s.heap_used = GetHeapUsage();
+  }
+
+  void Record(const Timer & timer, size_t rows, size_t elements, size_t memory) {
+    Record(timer.GetPhase(), timer.GetSeconds(), rows, elements, memory);
+  }
+
+  void Reset() {
+    for (Stats & s : stats) s = Stats();
+  }
+};
+
+}
+
+#endif
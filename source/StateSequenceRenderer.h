@@ -0,0 +1,419 @@
+#ifndef STATE_SEQUENCE_RENDERER_H
+#define STATE_SEQUENCE_RENDERER_H
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+#include "StateSequenceDataset.h"
+#include "StateSequenceLayout.h"
+#include "StateSequenceLOD.h"
+
+namespace emp {
+
+/// Browser-free renderer for one category of a StateSequenceDataset. Uses the same layout as
+/// StateSequenceVisualization (margins, domains, sequence width, d3-style axis ticks) and writes
+/// the result as SVG or as a raster image (PNG). Categories with more sequences/states than can be
+/// resolved are drawn as a level-of-detail summary (as in the visualization's AUTO mode).
+/// A renderer only reads the dataset, so separate renderers can work on one dataset in parallel.
+class StateSequenceRenderer {
+public:
+  using code_t = StateSequenceDataset::code_t;
+
+  struct Color {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+
+    Color(uint8_t _r=0, uint8_t _g=0, uint8_t _b=0) : r(_r), g(_g), b(_b) { ; }
+
+    /// Color from a 0xRRGGBB value.
+    static Color FromHex(uint32_t hex) { return Color((uint8_t) (hex >> 16), (uint8_t) (hex >> 8), (uint8_t) hex); }
+
+    std::string ToString() const {
+      static const char * digits = "0123456789abcdef";
+      std::string str("#");
+      for (uint8_t channel : { r, g, b }) {
+        str += digits[channel >> 4];
+        str += digits[channel & 15];
+      }
+      return str;
+    }
+  };
+
+  /// Simple RGB raster image.
+  class Image {
+  protected:
+    size_t width;
+    size_t height;
+    emp::vector<uint8_t> pixels;  ///< Row-major RGB.
+
+    static uint32_t CRC(const uint8_t * bytes, size_t size, uint32_t crc=0) {
+      // (Static local initialization is thread-safe, so images can be written in parallel.)
+      static const emp::vector<uint32_t> table = []() {
+        emp::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+          uint32_t c = n;
+          for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+          t[n] = c;
+        }
+        return t;
+      }();
+      crc = ~crc;
+      for (size_t i = 0; i < size; ++i) crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+      return ~crc;
+    }
+
+    static void PutU32(emp::vector<uint8_t> & out, uint32_t value) {
+      out.insert(out.end(), { (uint8_t) (value >> 24), (uint8_t) (value >> 16), (uint8_t) (value >> 8), (uint8_t) value });
+    }
+
+    static void WriteChunk(std::ostream & os, const char * type, const emp::vector<uint8_t> & body) {
+      emp::vector<uint8_t> chunk;
+      PutU32(chunk, (uint32_t) body.size());
+      chunk.insert(chunk.end(), type, type + 4);
+      chunk.insert(chunk.end(), body.begin(), body.end());
+      PutU32(chunk, CRC(chunk.data() + 4, chunk.size() - 4));
+      os.write(reinterpret_cast<const char *>(chunk.data()), (std::streamsize) chunk.size());
+    }
+
+  public:
+    Image(size_t _width=0, size_t _height=0, Color background=Color(255, 255, 255))
+      : width(_width), height(_height), pixels()
+    {
+      pixels.resize(width * height * 3);
+      for (size_t i = 0; i < width * height; ++i) {
+        pixels[3 * i] = background.r;
+        pixels[3 * i + 1] = background.g;
+        pixels[3 * i + 2] = background.b;
+      }
+    }
+
+    size_t GetWidth() const { return width; }
+    size_t GetHeight() const { return height; }
+    const emp::vector<uint8_t> & GetPixels() const { return pixels; }
+
+    Color Get(size_t x, size_t y) const {
+      emp_assert(x < width && y < height, x, y);
+      const uint8_t * px = pixels.data() + 3 * (y * width + x);
+      return Color(px[0], px[1], px[2]);
+    }
+
+    void Set(long x, long y, Color color) {
+      if (x < 0 || y < 0 || (size_t) x >= width || (size_t) y >= height) return;
+      uint8_t * px = pixels.data() + 3 * ((size_t) y * width + (size_t) x);
+      px[0] = color.r;
+      px[1] = color.g;
+      px[2] = color.b;
+    }
+
+    /// Fill pixels [x0, x1) x [y0, y1) (clipped to the image).
+    void Fill(long x0, long y0, long x1, long y1, Color color) {
+      x0 = std::max(x0, 0L);
+      y0 = std::max(y0, 0L);
+      x1 = std::min(x1, (long) width);
+      y1 = std::min(y1, (long) height);
+      for (long y = y0; y < y1; ++y) {
+        for (long x = x0; x < x1; ++x) Set(x, y, color);
+      }
+    }
+
+    /// Write the image as an (uncompressed) PNG: the zlib stream uses stored deflate blocks, so no
+    /// compression library is needed.
+    bool WritePNG(std::ostream & os) const {
+      static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+      os.write(reinterpret_cast<const char *>(signature), 8);
+
+      emp::vector<uint8_t> header;
+      PutU32(header, (uint32_t) width);
+      PutU32(header, (uint32_t) height);
+      header.insert(header.end(), { 8, 2, 0, 0, 0 });  // 8-bit RGB, no interlacing.
+      WriteChunk(os, "IHDR", header);
+
+      // Scanlines (filter type 0), wrapped in stored deflate blocks of at most 65535 bytes.
+      emp::vector<uint8_t> raw;
+      raw.reserve(height * (1 + 3 * width));
+      for (size_t y = 0; y < height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + (long) (3 * y * width), pixels.begin() + (long) (3 * (y + 1) * width));
+      }
+      emp::vector<uint8_t> zdata = { 0x78, 0x01 };
+      uint32_t adler_a = 1;
+      uint32_t adler_b = 0;
+      for (uint8_t byte : raw) {
+        adler_a = (adler_a + byte) % 65521;
+        adler_b = (adler_b + adler_a) % 65521;
+      }
+      size_t pos = 0;
+      do {
+        const size_t block = std::min<size_t>(65535, raw.size() - pos);
+        const bool last = (pos + block == raw.size());
+        zdata.insert(zdata.end(), { (uint8_t) (last ? 1 : 0), (uint8_t) block, (uint8_t) (block >> 8),
+                                    (uint8_t) ~block, (uint8_t) (~block >> 8) });
+        zdata.insert(zdata.end(), raw.begin() + (long) pos, raw.begin() + (long) (pos + block));
+        pos += block;
+      } while (pos < raw.size());
+      PutU32(zdata, (adler_b << 16) | adler_a);
+      WriteChunk(os, "IDAT", zdata);
+      WriteChunk(os, "IEND", emp::vector<uint8_t>());
+      return (bool) os;
+    }
+
+    bool WritePNG(const std::string & filename) const {
+      std::ofstream file(filename, std::ios::binary);
+      return file && WritePNG(file);
+    }
+  };
+
+protected:
+  /// One rectangle to draw, in data units.
+  struct Rect {
+    double x;
+    double y;
+    double width;
+    double height;
+    code_t state;
+  };
+
+  StateSequenceLayout layout;
+  bool use_lod;                                         ///< Summarize categories that can't be resolved?
+  std::unordered_map<std::string, Color> state_colors;  ///< Colors set with SetStateColor.
+  StateSequenceLOD lod;
+  emp::vector<Rect> rects;                              ///< Scratch: rects for the category being rendered.
+
+  /// Default colors (d3.scale.category20), assigned by state code.
+  static Color PaletteColor(code_t state) {
+    static const uint32_t palette[20] = {
+      0x1f77b4, 0xaec7e8, 0xff7f0e, 0xffbb78, 0x2ca02c, 0x98df8a, 0xd62728, 0xff9896, 0x9467bd, 0xc5b0d5,
+      0x8c564b, 0xc49c94, 0xe377c2, 0xf7b6d2, 0x7f7f7f, 0xc7c7c7, 0xbcbd22, 0xdbdb8d, 0x17becf, 0x9edae5
+    };
+    return Color::FromHex(palette[(size_t) state % 20]);
+  }
+
+  static std::string EscapeXML(const std::string & str) {
+    std::string out;
+    for (char c : str) {
+      switch (c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '"': out += "&quot;"; break;
+        default: out += c;
+      }
+    }
+    return out;
+  }
+
+  /// 3x5 glyphs for tick labels (one bit per pixel, top row first).
+  static uint16_t Glyph(char c) {
+    switch (c) {
+      case '0': return 0x7B6F;
+      case '1': return 0x2C97;
+      case '2': return 0x73E7;
+      case '3': return 0x73CF;
+      case '4': return 0x5BC9;
+      case '5': return 0x79CF;
+      case '6': return 0x79EF;
+      case '7': return 0x7249;
+      case '8': return 0x7BEF;
+      case '9': return 0x7BCF;
+      case ',': return 0x0014;
+      case '.': return 0x0002;
+      case '-': return 0x01C0;
+      default: return 0;
+    }
+  }
+
+  /// Draw text into image with its right edge at x and vertically centered on y (glyphs scaled 2x).
+  static void DrawLabel(Image & image, const std::string & text, long x, long y, Color color) {
+    const long scale = 2;
+    const long advance = 4 * scale;
+    long left = x - (long) text.size() * advance + scale;
+    const long top = y - (5 * scale) / 2;
+    for (char c : text) {
+      const uint16_t bits = Glyph(c);
+      for (long row = 0; row < 5; ++row) {
+        for (long col = 0; col < 3; ++col) {
+          if (bits & (1 << (14 - 3 * row - col))) {
+            image.Fill(left + col * scale, top + row * scale, left + (col + 1) * scale, top + (row + 1) * scale, color);
+          }
+        }
+      }
+      left += advance;
+    }
+  }
+
+public:
+  StateSequenceRenderer(double width=800.0, double height=500.0)
+    : layout(width, height), use_lod(true), state_colors(), lod(), rects()
+  { ; }
+
+  const StateSequenceLayout & GetLayout() const { return layout; }
+
+  void SetSize(double width, double height) { layout.SetSize(width, height); }
+  void SetMargins(const StateSequenceLayout::Margin & margins) { layout.SetMargins(margins); }
+
+  /// Should categories that can't be resolved at this size be drawn as level-of-detail summaries?
+  void SetUseLOD(bool val) { use_lod = val; }
+
+  /// Use color for states named name (otherwise states get palette colors by state code).
+  void SetStateColor(const std::string & name, Color color) { state_colors[name] = color; }
+
+  /// Lay out category cat: fit the view to its domain and collect the rects to draw (states, or
+  /// level-of-detail runs). Returns whether they are individual states (which get outlines) rather
+  /// than summary bins. (Called by the Render functions; public so that layout can be timed alone.)
+  bool Layout(const StateSequenceDataset & data, code_t cat, const StateSequenceIntervalIndex * index=nullptr) {
+    const auto & domain = data.GetDomain(cat);
+    const auto & seqs = data.GetCategorySequences(cat);
+    layout.SetView(domain);
+    rects.clear();
+    StateSequenceLOD::Viewport view(0, seqs.size(), domain.y_min, domain.y_max,
+                                    (size_t) std::max(1.0, layout.GetCanvasWidth()),
+                                    (size_t) std::max(1.0, layout.GetCanvasHeight()));
+    if (use_lod && !StateSequenceLOD::IsResolvable(data, cat, view, index)) {
+      lod.Build(data, cat, view, index);
+      const auto & runs = lod.GetRuns();
+      for (size_t r = 0; r < runs.size(); r += StateSequenceLOD::RUN_FIELDS) {
+        rects.push_back({ runs[r], runs[r + 2], runs[r + 1] - runs[r], runs[r + 3] - runs[r + 2], (code_t) runs[r + 4] });
+      }
+      return false;
+    }
+    const auto & begins = data.GetSequenceBegins();
+    const auto & lengths = data.GetSequenceLengths();
+    for (size_t pos = 0; pos < seqs.size(); ++pos) {
+      const size_t seq = seqs[pos];
+      for (size_t k = begins[seq]; k < begins[seq] + lengths[seq]; ++k) {
+        rects.push_back({ (double) pos, data.GetStarts()[k], StateSequenceLayout::SEQUENCE_WIDTH,
+                          data.GetDurations()[k], data.GetStates()[k] });
+      }
+    }
+    return true;
+  }
+
+  /// Number of rects produced by the last layout.
+  size_t GetNumRects() const { return rects.size(); }
+
+  Color GetStateColor(const StateSequenceDataset & data, code_t state) const {
+    auto it = state_colors.find(data.GetStateDictionary()[state]);
+    return (it == state_colors.end()) ? PaletteColor(state) : it->second;
+  }
+
+  /// Render category cat of data as an SVG document (structured like the visualization's).
+  bool RenderSVG(const StateSequenceDataset & data, code_t cat, std::ostream & os,
+                 const StateSequenceIntervalIndex * index=nullptr) {
+    const bool outline = Layout(data, cat, index);
+    const auto & margins = layout.GetMargins();
+    const auto & view = layout.GetView();
+    const double canvas_width = layout.GetCanvasWidth();
+    const double canvas_height = layout.GetCanvasHeight();
+    const auto old_precision = os.precision(10);
+
+    os << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << layout.GetWidth()
+       << "\" height=\"" << layout.GetHeight() << "\">\n";
+    os << "<defs><clipPath id=\"clip\"><rect width=\"" << canvas_width << "\" height=\"" << canvas_height
+       << "\"/></clipPath></defs>\n";
+    os << "<g class=\"StateSequenceVisualization-canvas\" transform=\"translate(" << margins.left << ","
+       << margins.top << ")\">\n";
+    os << "<g class=\"StateSequenceVisualization-data_canvas\" clip-path=\"url(#clip)\">\n";
+    os << "<g class=\"StateSequenceVisualization-" << (outline ? "category" : "lod") << "\"";
+    if (outline) os << " stroke=\"white\" stroke-width=\"0.5\"";
+    os << " transform=\"scale(" << layout.GetXScale() << "," << layout.GetYScale() << ") translate("
+       << -view.x_min << "," << -view.y_min << ")\">\n";
+    for (const Rect & rect : rects) {
+      os << "<rect class=\"" << EscapeXML(data.GetStateDictionary()[rect.state]) << "\" x=\"" << rect.x
+         << "\" y=\"" << rect.y << "\" width=\"" << rect.width << "\" height=\"" << rect.height
+         << "\" fill=\"" << GetStateColor(data, rect.state).ToString() << "\"";
+      if (outline) os << " vector-effect=\"non-scaling-stroke\"";
+      os << "/>\n";
+    }
+    os << "</g>\n</g>\n";
+
+    // Axes, as d3.svg.axis draws them (the x axis has no ticks).
+    const std::string axis_style = "fill:none;stroke:black;shape-rendering:crispEdges";
+    const double tick = StateSequenceLayout::TICK_SIZE;
+    os << "<g class=\"axis y_axis\" font-family=\"sans-serif\" font-size=\"10px\">\n";
+    const double step = StateSequenceLayout::TickStep(view.y_min, view.y_max);
+    for (double value : StateSequenceLayout::Ticks(view.y_min, view.y_max)) {
+      os << "<g class=\"tick\" transform=\"translate(0," << layout.Y(value) << ")\">"
+         << "<line x2=\"" << -tick << "\" y2=\"0\" style=\"" << axis_style << "\"/>"
+         << "<text x=\"" << -(tick + 3) << "\" y=\"0\" dy=\".32em\" style=\"text-anchor:end\">"
+         << StateSequenceLayout::TickLabel(value, step) << "</text></g>\n";
+    }
+    os << "<path class=\"domain\" d=\"M" << -tick << ",0H0V" << canvas_height << "H" << -tick
+       << "\" style=\"" << axis_style << "\"/>\n</g>\n";
+    os << "<g class=\"axis x_axis\"><path class=\"domain\" d=\"M0," << -tick << "V0H" << canvas_width
+       << "V" << -tick << "\" style=\"" << axis_style << "\"/></g>\n";
+    os << "</g>\n</svg>\n";
+    os.precision(old_precision);
+    return (bool) os;
+  }
+
+  bool RenderSVG(const StateSequenceDataset & data, code_t cat, const std::string & filename,
+                 const StateSequenceIntervalIndex * index=nullptr) {
+    std::ofstream file(filename);
+    return file && RenderSVG(data, cat, file, index);
+  }
+
+  /// Render category cat of data into a raster image (the size of the layout).
+  Image RenderImage(const StateSequenceDataset & data, code_t cat, const StateSequenceIntervalIndex * index=nullptr) {
+    const bool outline = Layout(data, cat, index);
+    const auto & margins = layout.GetMargins();
+    const auto & view = layout.GetView();
+    Image image((size_t) std::max(0.0, std::round(layout.GetWidth())),
+                (size_t) std::max(0.0, std::round(layout.GetHeight())));
+    const Color white(255, 255, 255);
+    const Color black(0, 0, 0);
+    const long left = (long) std::round(margins.left);
+    const long top = (long) std::round(margins.top);
+    const long canvas_right = left + (long) std::round(layout.GetCanvasWidth());
+    const long canvas_bottom = top + (long) std::round(layout.GetCanvasHeight());
+
+    // Pixels whose centers fall inside a rect are filled (at least one pixel per rect).
+    auto Snap = [](double lo, double hi, long & first, long & last) {
+      first = (long) std::ceil(lo - 0.5);
+      last = (long) std::ceil(hi - 0.5);
+      if (last <= first) {
+        first = (long) std::floor((lo + hi) / 2.0);
+        last = first + 1;
+      }
+    };
+    for (const Rect & rect : rects) {
+      long x0, x1, y0, y1;
+      Snap(left + layout.X(rect.x), left + layout.X(rect.x + rect.width), x0, x1);
+      Snap(top + layout.Y(rect.y), top + layout.Y(rect.y + rect.height), y0, y1);
+      x0 = std::max(x0, left);
+      x1 = std::min(x1, canvas_right);
+      y0 = std::max(y0, top);
+      y1 = std::min(y1, canvas_bottom);
+      image.Fill(x0, y0, x1, y1, GetStateColor(data, rect.state));
+      // Separate consecutive states (like the SVG outline) wherever there is room for it.
+      if (outline && y1 - y0 >= 3) image.Fill(x0, y0, x1, y0 + 1, white);
+    }
+
+    // Axes.
+    const long tick = (long) StateSequenceLayout::TICK_SIZE;
+    image.Fill(left - 1, top - 1, left, canvas_bottom, black);
+    image.Fill(left - tick, top - 1, left, top, black);
+    image.Fill(left - tick, canvas_bottom - 1, left, canvas_bottom, black);
+    image.Fill(left - 1, top - tick, canvas_right, top, black);
+    image.Fill(canvas_right - 1, top - tick, canvas_right, top, black);
+    const double step = StateSequenceLayout::TickStep(view.y_min, view.y_max);
+    for (double value : StateSequenceLayout::Ticks(view.y_min, view.y_max)) {
+      const long y = top + (long) std::round(layout.Y(value));
+      image.Fill(left - tick, y, left, y + 1, black);
+      DrawLabel(image, StateSequenceLayout::TickLabel(value, step), left - tick - 3, y, black);
+    }
+    return image;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef STATE_SEQUENCE_STATISTICS_H
+#define STATE_SEQUENCE_STATISTICS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+#include "StateSequenceDataset.h"
+#include "ThreadPool.h"
+
+namespace emp {
+
+/// Per-category aggregates over the states of a StateSequenceDataset: how often sequences go from
+/// one state to the next (a transition-count matrix), how many stays each state has, and the total
+/// time spent in it (its occupancy; occupancy over stays is the mean dwell time). Each category only
+/// gets slots for the states that occur in it (as in StateSequenceFrequency), so its matrix is sized
+/// by those rather than by the whole state dictionary. Stale categories are computed together in one
+/// pass over their sequences, split into similar-sized pieces that are spread over a ThreadPool (if
+/// given); each worker accumulates into a single matrix of its own. Results are cached per category.
+class StateSequenceStatistics {
+public:
+  using code_t = StateSequenceDataset::code_t;
+  using index_t = StateSequenceDataset::index_t;
+
+  static constexpr size_t NO_SLOT = (size_t) -1;   ///< Returned by GetSlot for states not in a category.
+
+  /// Aggregates for one category.
+  struct Summary {
+    size_t num_seqs;                    ///< Sequences counted.
+    emp::vector<code_t> states;         ///< States occurring in the category (ascending codes), one per slot.
+    emp::vector<uint64_t> transitions;  ///< Row-major [from slot][to slot]: times a state is followed by another.
+    emp::vector<uint64_t> visits;       ///< Per slot: number of stays in the state.
+    emp::vector<double> occupancy;      ///< Per slot: total time spent in the state.
+
+    Summary() : num_seqs(0), states(), transitions(), visits(), occupancy() { ; }
+
+    /// Empty the summary, with one slot for each of _states.
+    void Reset(const emp::vector<code_t> & _states) {
+      num_seqs = 0;
+      states = _states;
+      transitions.assign(states.size() * states.size(), 0);
+      visits.assign(states.size(), 0);
+      occupancy.assign(states.size(), 0.0);
+    }
+
+    /// Add other's counts (over the same slots) to ours.
+    void Add(const Summary & other) {
+      emp_assert(other.states == states);
+      num_seqs += other.num_seqs;
+      for (size_t i = 0; i < transitions.size(); ++i) transitions[i] += other.transitions[i];
+      for (size_t s = 0; s < states.size(); ++s) {
+        visits[s] += other.visits[s];
+        occupancy[s] += other.occupancy[s];
+      }
+    }
+
+    size_t GetNumStates() const { return states.size(); }
+
+    /// Slot of state (NO_SLOT if it does not occur in the category).
+    size_t GetSlot(code_t state) const {
+      auto it = std::lower_bound(states.begin(), states.end(), state);
+      return (it != states.end() && *it == state) ? (size_t) (it - states.begin()) : NO_SLOT;
+    }
+
+    /// Times state from is directly followed by state to.
+    uint64_t GetTransitions(code_t from, code_t to) const {
+      const size_t from_slot = GetSlot(from);
+      const size_t to_slot = GetSlot(to);
+      if (from_slot == NO_SLOT || to_slot == NO_SLOT) return 0;
+      return transitions[from_slot * states.size() + to_slot];
+    }
+
+    uint64_t GetVisits(code_t state) const {
+      const size_t slot = GetSlot(state);
+      return (slot == NO_SLOT) ? 0 : visits[slot];
+    }
+
+    double GetOccupancy(code_t state) const {
+      const size_t slot = GetSlot(state);
+      return (slot == NO_SLOT) ? 0.0 : occupancy[slot];
+    }
+
+    /// Mean length of a stay in state (0 if it never occurs).
+    double GetMeanDwell(code_t state) const {
+      const uint64_t count = GetVisits(state);
+      return count ? GetOccupancy(state) / (double) count : 0.0;
+    }
+  };
+
+protected:
+  struct Entry {
+    bool valid;
+    Summary summary;
+
+    Entry() : valid(false), summary() { ; }
+  };
+
+  /// Part of one category's sequences.
+  struct Piece {
+    code_t cat;
+    size_t first;                 ///< Range of positions in the category's sequence list.
+    size_t last;
+    emp::vector<code_t> states;   ///< Distinct states occurring in the piece.
+
+    Piece(code_t _cat, size_t _first, size_t _last) : cat(_cat), first(_first), last(_last), states() { ; }
+  };
+
+  emp::vector<Entry> entries;   ///< Per category code.
+  size_t min_piece_states;      ///< Smallest number of states worth a piece of its own.
+
+  bool IsCurrent(const StateSequenceDataset & data, code_t cat) const {
+    if (cat < 0 || (size_t) cat >= entries.size()) return false;
+    const Entry & entry = entries[(size_t) cat];
+    return entry.valid && entry.summary.num_seqs == data.GetCategorySequences(cat).size();
+  }
+
+  /// Call fun(i) for every i in [0, count), over pool if there is one.
+  template <typename FUN_T>
+  static void ForEach(size_t count, ThreadPool * pool, FUN_T && fun) {
+    if (pool) {
+      pool->ParallelFor(count, fun);
+    } else {
+      for (size_t i = 0; i < count; ++i) fun(i);
+    }
+  }
+
+  /// Collect the distinct states of piece (marks is scratch space: one zeroed entry per state code).
+  static void FindPieceStates(const StateSequenceDataset & data, Piece & piece, emp::vector<char> & marks) {
+    const auto & seqs = data.GetCategorySequences(piece.cat);
+    const auto & begins = data.GetSequenceBegins();
+    const auto & lengths = data.GetSequenceLengths();
+    const code_t * states = data.GetStates().data();
+    piece.states.clear();
+    for (size_t pos = piece.first; pos < piece.last; ++pos) {
+      for (size_t k = begins[seqs[pos]]; k < begins[seqs[pos]] + lengths[seqs[pos]]; ++k) {
+        if (marks[(size_t) states[k]]) continue;
+        marks[(size_t) states[k]] = 1;
+        piece.states.push_back(states[k]);
+      }
+    }
+    for (code_t state : piece.states) marks[(size_t) state] = 0;
+  }
+
+  /// Count the sequences of piece into out, whose slots are given by slot_of (per state code).
+  static void SummarizePiece(const StateSequenceDataset & data, const Piece & piece,
+                             const emp::vector<int32_t> & slot_of, Summary & out) {
+    const auto & seqs = data.GetCategorySequences(piece.cat);
+    const auto & begins = data.GetSequenceBegins();
+    const auto & lengths = data.GetSequenceLengths();
+    const code_t * states = data.GetStates().data();
+    const double * durations = data.GetDurations().data();
+    const size_t num_slots = out.states.size();
+    for (size_t pos = piece.first; pos < piece.last; ++pos) {
+      const size_t begin = begins[seqs[pos]];
+      const size_t end = begin + lengths[seqs[pos]];
+      size_t prev = 0;
+      for (size_t k = begin; k < end; ++k) {
+        const size_t slot = (size_t) slot_of[(size_t) states[k]];
+        ++out.visits[slot];
+        out.occupancy[slot] += durations[k];
+        if (k > begin) ++out.transitions[prev * num_slots + slot];
+        prev = slot;
+      }
+    }
+    out.num_seqs += piece.last - piece.first;
+  }
+
+  /// Bring categories cats up to date together. Their sequences are cut into pieces of roughly equal
+  /// numbers of states (a few per thread). The states of each piece are collected first, to size
+  /// each category's slots; then every worker takes its share of the pieces (in category order) and
+  /// sums them into one accumulator of its own, which is added to a category's summary as the worker
+  /// moves past it. Scratch space is one category matrix per worker, whatever the number of pieces.
+  void Compute(const StateSequenceDataset & data, const emp::vector<code_t> & cats, ThreadPool * pool) {
+    if (cats.empty()) return;
+    if (entries.size() < data.GetNumCategories()) entries.resize(data.GetNumCategories());
+    const auto & lengths = data.GetSequenceLengths();
+    const size_t alphabet_size = data.GetStateNames().size();
+    size_t total_states = 0;
+    for (code_t cat : cats) {
+      for (index_t seq : data.GetCategorySequences(cat)) total_states += lengths[seq];
+    }
+    const size_t num_threads = pool ? pool->GetNumThreads() : 1;
+    const size_t piece_states = std::max(min_piece_states, total_states / (4 * num_threads) + 1);
+
+    emp::vector<Piece> pieces;
+    for (code_t cat : cats) {
+      const auto & seqs = data.GetCategorySequences(cat);
+      size_t first = 0;
+      size_t states = 0;
+      for (size_t pos = 0; pos < seqs.size(); ++pos) {
+        states += lengths[seqs[pos]];
+        if (states >= piece_states) {
+          pieces.emplace_back(cat, first, pos + 1);
+          first = pos + 1;
+          states = 0;
+        }
+      }
+      if (first < seqs.size() || first == 0) pieces.emplace_back(cat, first, seqs.size());
+    }
+
+    // Slots: the states occurring in each category.
+    ForEach(pieces.size(), pool, [&data, &pieces, alphabet_size](size_t i) {
+      emp::vector<char> marks(alphabet_size, 0);
+      FindPieceStates(data, pieces[i], marks);
+    });
+    {
+      emp::vector<char> marks(alphabet_size, 0);
+      emp::vector<code_t> states;
+      size_t i = 0;
+      for (code_t cat : cats) {
+        states.clear();
+        for (; i < pieces.size() && pieces[i].cat == cat; ++i) {
+          for (code_t state : pieces[i].states) {
+            if (marks[(size_t) state]) continue;
+            marks[(size_t) state] = 1;
+            states.push_back(state);
+          }
+        }
+        for (code_t state : states) marks[(size_t) state] = 0;
+        std::sort(states.begin(), states.end());
+        Entry & entry = entries[(size_t) cat];
+        entry.summary.Reset(states);
+        entry.valid = true;
+      }
+    }
+
+    // Counts: worker w takes pieces w, w + num_workers, ...
+    const size_t num_workers = std::min(num_threads, pieces.size());
+    std::mutex mutex;
+    ForEach(num_workers, pool, [this, &data, &pieces, &mutex, num_workers, alphabet_size](size_t w) {
+      emp::vector<int32_t> slot_of(alphabet_size, -1);
+      Summary part;
+      code_t cur = -1;
+      auto Flush = [this, &mutex, &part, &cur]() {
+        if (cur == -1) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[(size_t) cur].summary.Add(part);
+      };
+      for (size_t i = w; i < pieces.size(); i += num_workers) {
+        const Piece & piece = pieces[i];
+        if (piece.cat != cur) {
+          Flush();
+          cur = piece.cat;
+          const auto & states = entries[(size_t) cur].summary.states;
+          for (size_t slot = 0; slot < states.size(); ++slot) slot_of[(size_t) states[slot]] = (int32_t) slot;
+          part.Reset(states);
+        }
+        SummarizePiece(data, piece, slot_of, part);
+      }
+      Flush();
+    });
+  }
+
+public:
+  StateSequenceStatistics(size_t _min_piece_states=(1 << 16))
+    : entries(), min_piece_states(std::max<size_t>(1, _min_piece_states))
+  { ; }
+
+  /// Forget every cached category (e.g., when the dataset is replaced).
+  void Clear() { entries.clear(); }
+
+  /// Forget category cat (e.g., when some of its sequences have been extended).
+  void Invalidate(code_t cat) {
+    if ((size_t) cat < entries.size()) entries[(size_t) cat].valid = false;
+  }
+
+  /// Has the summary of category cat been computed since it last changed?
+  bool IsCached(const StateSequenceDataset & data, code_t cat) const { return IsCurrent(data, cat); }
+
+  /// Bring every category of data up to date in one (parallel, if pool is given) pass.
+  void Update(const StateSequenceDataset & data, ThreadPool * pool=nullptr) {
+    emp::vector<code_t> stale;
+    for (size_t cat = 0; cat < data.GetNumCategories(); ++cat) {
+      if (!IsCurrent(data, (code_t) cat)) stale.push_back((code_t) cat);
+    }
+    Compute(data, stale, pool);
+  }
+
+  /// Get the summary of category cat of data, computed on first use and again whenever the category
+  /// has grown (or been invalidated) since.
+  const Summary & Get(const StateSequenceDataset & data, code_t cat, ThreadPool * pool=nullptr) {
+    emp_assert(cat >= 0 && (size_t) cat < data.GetNumCategories(), cat, data.GetNumCategories());
+    if (!IsCurrent(data, cat)) Compute(data, emp::vector<code_t>(1, cat), pool);
+    return entries[(size_t) cat].summary;
+  }
+};
+
+}
+
+#endif
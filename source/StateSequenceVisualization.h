@@ -3,7 +3,11 @@
 
 #include <string>
 #include <iostream>
+#include <memory>
+#include <functional>
 #include <chrono>
+#include <algorithm>
+#include <cmath>
 
 #include "base/Ptr.h"
 #include "base/vector.h"
@@ -14,25 +18,64 @@
 #include "web/d3/dataset.h"
 #include "web/d3/visualizations.h"
 
+#include "StateSequenceBinary.h"
+#include "StateSequenceCSVStream.h"
+#include "StateSequenceDataset.h"
+#include "StateSequenceDatasetStore.h"
+#include "StateSequenceDecompressor.h"
+#include "StateSequenceFrequency.h"
+#include "StateSequenceIntervalIndex.h"
+#include "StateSequenceLayout.h"
+#include "StateSequenceLOD.h"
+#include "StateSequenceOrdering.h"
+#include "StateSequenceProfiler.h"
+#include "StateSequenceStatistics.h"
+
 namespace emp {
 namespace web {
 
 class StateSequenceVisualization : public D3Visualization {
-protected:
-  /// Convenient structure to keep track of margins. (currently no editing this)
-  struct Margin {
-    double top;
-    double right;
-    double bottom;
-    double left;
-
-    Margin(double _top=10.0, double _right=10.0, double _bottom=10.0, double _left=50.0)
-      : top(_top), right(_right), bottom(_bottom), left(_left)
-    { ; }
+public:
+  /// When to draw a level-of-detail (pixel binned) summary instead of every state:
+  ///   * OFF: always draw every state.
+  ///   * AUTO: draw the summary only while individual sequences/states cannot be resolved.
+  ///   * ALWAYS: always draw the summary.
+  enum class LODMode { OFF=0, AUTO, ALWAYS };
+
+  /// How sequences are drawn:
+  ///   * SVG: one element per state (per bin in level-of-detail mode); stylable, exportable.
+  ///   * CANVAS: painted into a 2D <canvas> over the data area; much lighter for large data.
+  enum class RenderBackend { SVG=0, CANVAS };
+
+  /// Where sequences are placed along the x axis:
+  ///   * FILE: in the order they were loaded.
+  ///   * SIMILARITY: in the leaf order of a hierarchical clustering of each category's sequences
+  ///     (see StateSequenceOrdering), so similar sequences are drawn side by side.
+  enum class SequenceOrder { FILE=0, SIMILARITY };
+
+  /// Result of a point query (see QueryAt): what is drawn under a point of the visualization.
+  struct Hit {
+    bool found;                               ///< Is there a state under the point?
+    size_t position;                          ///< Sequence position (x axis) of the point.
+    StateSequenceDataset::index_t sequence;   ///< Sequence drawn at that position.
+    StateSequenceDataset::index_t state;      ///< State under the point (an index into the state columns).
+    double time;                              ///< Time (y axis) of the point.
+
+    Hit() : found(false), position(0), sequence(0), state(0), time(0.0) { ; }
   };
 
+  using hit_fun_t = std::function<void(const Hit &)>;
+
+protected:
+  /// Margins are shared with the native renderer's layout. (currently no editing this)
+  using Margin = StateSequenceLayout::Margin;
+  using Source = StateSequenceDatasetStore::Source;
+
   Margin margins;
 
+  /// Space (in pixels) between the data area and the state-frequency panel.
+  static constexpr double FREQUENCY_GAP = 10.0;
+
   bool dynamic_width;               ///< Do we dynamically resize visualization width based on parent element width?
   bool data_drawn;                  ///< Have we finished drawing the data yet?
   bool data_loaded;                 ///< Have we finished loading the data yet?
@@ -45,6 +88,48 @@ protected:
   std::string seqID_cname;           ///< Column name in the dataset that specifies sequence ID within its category.
   std::string seq_delim;             ///< Sequence delimiter.
 
+  std::shared_ptr<Source> source;       ///< Natively parsed sequence data (shared with other views of it).
+  size_t source_listener;               ///< Our listener ID with source.
+  bool source_loader;                   ///< Are we the one loading source?
+  StateSequenceCSVStream csv_stream;    ///< Incremental parser used for streaming loads.
+  bool streaming_load;                  ///< Parse/draw CSV data progressively as it downloads?
+  size_t stream_chunk_size;             ///< Maximum number of bytes handed to the parser at once.
+
+  size_t render_cache_budget;           ///< Max elements kept in detached (cached) category subtrees.
+
+  LODMode lod_mode;                     ///< When to draw the level-of-detail summary.
+  double lod_bin_size;                  ///< Size (in pixels) of level-of-detail bins.
+  bool lod_active;                      ///< Is the level-of-detail summary currently displayed?
+  StateSequenceLOD lod;                 ///< Level-of-detail summary of the current category.
+
+  bool zoomed;                                ///< Has a viewport been set (by zooming or SetViewport)?
+  bool zooming;                               ///< Is a zoom gesture being applied right now?
+  StateSequenceDataset::Domain viewport;      ///< Requested view (sequence positions x time), if zoomed.
+  emp::vector<StateSequenceDataset::index_t> view_states;     ///< States drawn in the culled view.
+  emp::vector<StateSequenceDataset::index_t> view_positions;  ///< Sequence position of each of those.
+
+  hit_fun_t hover_fun;                  ///< Called when the state under the mouse changes (if set).
+  hit_fun_t click_fun;                  ///< Called with the state under a click (if set).
+  Hit hover_hit;                        ///< Last state reported to hover_fun.
+
+  RenderBackend render_backend;         ///< Draw with SVG elements or on a 2D canvas?
+  emp::vector<double> canvas_rects;     ///< Rects to paint (x, y, width, height in data units), grouped by state.
+  emp::vector<int32_t> canvas_groups;   ///< Per state group: state code, first rect, number of rects.
+
+  StateSequenceProfiler profiler;       ///< Per-phase stats (recorded only with STATE_SEQ_VIS_PROFILE).
+
+  SequenceOrder sequence_order;             ///< Where sequences are placed along the x axis.
+  mutable StateSequenceOrdering ordering;   ///< Similarity orders, computed (and cached) on first use.
+
+  bool show_frequency;                  ///< Show the state-frequency panel right of the data area?
+  double frequency_width;               ///< Width of the state-frequency panel, in pixels.
+  StateSequenceFrequency frequency;     ///< State frequencies over time (events cached per category).
+  StateSequenceStatistics statistics;   ///< Transition counts, stays and occupancy (cached per category).
+
+  std::string csv_filename;                           ///< File our CSV data was loaded from (to follow it).
+  std::string append_error;                           ///< Why the last append failed (if it did).
+  emp::vector<StateSequenceDataset::index_t> pending_extended;  ///< Extended sequences not yet patched into the view.
+
   emp::vector<std::string> categories;  ///< Keeps tack of currently available sequence categories.
   std::string cur_category;             ///< Keeps track of current category to display. Validity is checked on Draw().
 
@@ -61,185 +146,939 @@ protected:
   /// Internal function to set the current category to cat. No validity checking.
   void SetCurrentCategoryInternal(const std::string & cat) { cur_category = cat; }
 
-  /// Internal data callback function. (called when data is done loading)
+  /// Internal data callback function. (called whenever new data has been loaded)
   void DataCallback() {
-    // Get categories out of js and into C++.
-    categories.clear();
-    emp::pass_vector_to_cpp(categories);
+    categories = source->dataset.GetCategories();
+    if (categories.size() == 0) return;
     // default to first category.
     if (cur_category == "") cur_category = categories[0];
-    data_loaded = true;
-    // Trigger a draw.
-    Draw();
+    if (!data_loaded) {
+      data_loaded = true;
+      // Trigger a draw.
+      Draw();
+    } else if (data_drawn) {
+      ScheduleDrawNewSequences();
+    }
   }
 
-  /// Internal load data from CSV function given the filename where data is stored.
-  void LoadDataFromCSV(std::string filename) {
+  /// Internal function called once a load has completely finished.
+  void LoadFinished() {
+    if (categories.size() == 0) {
+      EM_ASM_ARGS({
+        alert("Can't find categories for " + Pointer_stringify($0) + "! It's likely nothing will work");
+      }, GetID().c_str());
+    }
+  }
+
+  /// Internal function to report a failed load.
+  void LoadFailed(const std::string & error) {
+    EM_ASM_ARGS({
+      alert("Failed to load data for " + Pointer_stringify($0) + ": " + Pointer_stringify($1));
+    }, GetID().c_str(), error.c_str());
+  }
+
+  /// Internal function to record a finished phase and mirror its stats in JS (vis["stats"][phase name]).
+  void EndPhase(StateSequenceProfiler::Phase phase, double seconds, size_t rows, size_t elements) {
+    profiler.Record(phase, seconds, rows, elements, source->dataset.GetMemoryUsage());
+    const auto & stats = profiler.GetStats(phase);
+    EM_ASM_ARGS({
+      emp.StateSeqVis[Pointer_stringify($0)]["stats"][Pointer_stringify($1)] =
+        ({"count": $2, "total_time": $3, "last_time": $4, "max_time": $5, "rows": $6, "elements": $7,
+          "memory": $8, "heap_used": $9});
+    }, GetID().c_str(), StateSequenceProfiler::GetPhaseName(phase), stats.count, stats.total_time,
+       stats.last_time, stats.max_time, stats.rows, stats.elements, stats.memory, stats.heap_used);
+  }
+
+  void EndPhase(const StateSequenceProfiler::Timer & timer, size_t rows, size_t elements) {
+    EndPhase(timer.GetPhase(), timer.GetSeconds(), rows, elements);
+  }
+
+  /// Internal function to count the elements displayed in the current view (SVG elements or painted rects).
+  size_t CountDisplayedElements() const {
+    if (render_backend == RenderBackend::CANVAS) return canvas_rects.size() / 4;
+    if (lod_active) return lod.GetNumRuns();
+    if (IsCulling() || IsOrdered()) return view_states.size();
+    size_t count = 0;
+    for (size_t seq : source->dataset.GetCategorySequences(source->dataset.GetCategoryCode(cur_category))) {
+      count += source->dataset.GetSequenceLengths()[seq];
+    }
+    return count;
+  }
+
+  /// Internal function called by our source with news about its data.
+  void SourceCallback(Source::Notice notice) {
+    if (notice == Source::Notice::FINISHED) {
+      LoadFinished();
+      return;
+    }
+    // Extended sequences change their category's frequencies, statistics and similarity order, and need patching
+    // into whatever subtrees show them.
+    for (auto seq : source->extended) {
+      const auto cat = source->dataset.GetSequenceCategories()[seq];
+      frequency.Invalidate(cat);
+      ordering.Invalidate(cat);
+      statistics.Invalidate(cat);
+      pending_extended.push_back(seq);
+    }
+    DataCallback();
+  }
+
+  /// Internal function to stop using the current source. Its JS data goes with its last user.
+  /// A load we abandon is marked as failed, so that the next visualization to open it starts over.
+  void ReleaseSource() {
+    if (!source) return;
+    if (source_loader && source->status == Source::Status::LOADING) {
+      source->status = Source::Status::FAILED;
+      source->error = "Load abandoned.";
+    }
+    source_loader = false;
+    source->RemoveListener(source_listener);
+    if (source.use_count() == 1) {
+      EM_ASM_ARGS({
+        if (!emp.StateSeqData || !emp.StateSeqData[$0]) return;
+        var follow = emp.StateSeqData[$0]["follow"];
+        if (follow) clearInterval(follow["timer"]);
+        delete emp.StateSeqData[$0];
+      }, source->id);
+    }
+    source.reset();
+  }
+
+  /// Internal function to start using _source (and sharing its JS data, under emp.StateSeqData[id]).
+  /// If fresh, the source's data is emptied first, ready to be loaded by us.
+  void AttachSource(const std::shared_ptr<Source> & _source, bool fresh) {
+    source = _source;
+    source_listener = source->AddListener([this](Source::Notice notice) { this->SourceCallback(notice); });
+    if (fresh) source->Reset();
+    EM_ASM_ARGS({
+      if (!emp.StateSeqData) { emp.StateSeqData = {}; }
+      if (!emp.StateSeqBindColumn) {
+        // Make target[name] a typed array view of the size elements at ptr in the heap. The view is
+        // made on first use, and made again if the heap has grown since (detaching views of the old one).
+        emp.StateSeqBindColumn = function(target, name, ArrayType, ptr, size) {
+          var column = ({"view": null});
+          Object.defineProperty(target, name, ({"configurable": true, "enumerable": true, "get": function() {
+            if (column["view"] === null || column["view"].buffer !== HEAPU8.buffer) {
+              column["view"] = new ArrayType(HEAPU8.buffer, ptr, size);
+            }
+            return column["view"];
+          }}));
+        };
+      }
+      if ($2 || !emp.StateSeqData[$1]) {
+        emp.StateSeqData[$1] = ({"num_states": 0, "num_seqs": 0, "state_names": [], "seq_id_names": [],
+                                 "category_seqs": [], "category_counts": [], "categories": [], "domains": {}});
+      }
+      emp.StateSeqVis[Pointer_stringify($0)]["data"] = emp.StateSeqData[$1];
+    }, GetID().c_str(), source->id, fresh);
+  }
+
+  /// Internal function to switch to the (shared) source for key before a new load, throwing away
+  /// everything this visualization drew or derived from its previous data. Returns whether we need
+  /// to load the data ourselves: nobody has (successfully) loaded it, and nobody else is loading it.
+  bool OpenSource(const std::string & key) {
+    ReleaseSource();
+    bool created = false;
+    auto shared = StateSequenceDatasetStore::Global().Acquire(key, created);
+    const bool load = created || shared->status == Source::Status::FAILED;
+    AttachSource(shared, load);
+    source_loader = load;
+    categories.clear();
+    pending_extended.clear();
+    data_loaded = false;
+    data_drawn = false;
+    lod_active = false;
+    ordering.Clear();
+    frequency.Clear();
+    statistics.Clear();
+    zoomed = false;
+    hover_hit = Hit();
+    EM_ASM_ARGS({
+      var vis = emp.StateSeqVis[Pointer_stringify($0)];
+      // Loads started before now must not touch the new source (see LoadDataFromCSV).
+      vis["load_token"] = {};
+      vis["render_cache"]["entries"] = {};
+      vis["render_cache"]["elements"] = 0;
+      vis["active"] = null;
+      vis["lod"] = null;
+      vis["view"] = null;
+      vis["state_colors"] = {};
+      d3.select("#StateSequenceVisualization-data_canvas-" + Pointer_stringify($0)).selectAll("*").remove();
+      d3.select("#StateSequenceVisualization-frequency-" + Pointer_stringify($0)).selectAll("*").remove();
+    }, GetID().c_str());
+    return load;
+  }
+
+  /// Internal function to catch up with a source somebody else has loaded (or is loading).
+  void JoinSource() {
+    if (source->dataset.GetNumSequences() > 0) DataCallback();
+    if (source->status == Source::Status::LOADED) LoadFinished();
+  }
+
+  /// Internal function to record a failed load of our source (and report it).
+  void SourceFailed(const std::string & error) {
+    source_loader = false;
+    source->status = Source::Status::FAILED;
+    source->error = error;
+    LoadFailed(error);
+  }
+
+  /// Internal function to announce newly parsed sequences to everyone using our source.
+  void PublishData() {
+    ExportData();
+    source->Notify(Source::Notice::DATA);
+  }
+
+  /// Internal function to announce that our source is completely loaded.
+  void PublishFinished() {
+    source_loader = false;
+    source->status = Source::Status::LOADED;
+    source->Notify(Source::Notice::FINISHED);
+  }
+
+  /// Internal function to append names[first..] to the JS array data[field]. The names cross as
+  /// one packed buffer (each NUL-terminated, back to back) plus the offset of each terminator.
+  void ExportNames(const emp::vector<std::string> & names, size_t first, const char * field) {
+    if (first >= names.size()) return;
+    std::string packed;
+    emp::vector<uint32_t> ends;
+    for (size_t i = first; i < names.size(); ++i) {
+      packed += names[i];
+      ends.push_back((uint32_t) packed.size());
+      packed += '\0';
+    }
+    EM_ASM_ARGS({
+      var names = emp.StateSeqVis[Pointer_stringify($0)]["data"][Pointer_stringify($1)];
+      var begin = 0;
+      for (var i = 0; i < $4; i++) {
+        var end = HEAPU32[($3 >> 2) + i];
+        names.push((end > begin) ? Pointer_stringify($2 + begin, end - begin) : "");
+        begin = end + 1;
+      }
+    }, GetID().c_str(), field, packed.data(), ends.data(), ends.size());
+  }
+
+  /// Internal function to hand everything added to the (native) dataset since the last export
+  /// over to the JS renderer. Columns are not copied: the renderer gets typed array views of the
+  /// dataset's own vectors in the heap. Those move as the dataset grows, so the views are rebound
+  /// on every export (loaders always export before handing control back to JS). Sequences extended
+  /// since the last export are passed on to listeners through source->extended.
+  void ExportData() {
+    STATE_SEQ_PROFILE( StateSequenceProfiler::Timer timer(StateSequenceProfiler::Phase::EXPORT); )
+    auto & dataset = source->dataset;
+    ExportNames(dataset.GetStateNames(), source->exported_state_names, "state_names");
+    ExportNames(dataset.GetSequenceIDDictionary().GetNames(), source->exported_seqIDs, "seq_id_names");
+    ExportNames(dataset.GetCategories(), source->exported_categories, "categories");
+
+    emp::vector<double> domain_values;
+    for (size_t cat = 0; cat < dataset.GetNumCategories(); ++cat) {
+      const auto & domain = dataset.GetDomain((StateSequenceDataset::code_t) cat);
+      domain_values.insert(domain_values.end(), { domain.x_min, domain.x_max, domain.y_min, domain.y_max });
+    }
+
+    EM_ASM_ARGS({
+      var data = emp.StateSeqVis[Pointer_stringify($0)]["data"];
+      var num_states = $1;
+      var num_seqs = $2;
+      emp.StateSeqBindColumn(data, "states", Int32Array, $3, num_states);
+      emp.StateSeqBindColumn(data, "starts", Float64Array, $4, num_states);
+      emp.StateSeqBindColumn(data, "durations", Float64Array, $5, num_states);
+      emp.StateSeqBindColumn(data, "seq_begins", Uint32Array, $6, num_seqs);
+      emp.StateSeqBindColumn(data, "seq_lengths", Uint32Array, $7, num_seqs);
+      emp.StateSeqBindColumn(data, "seq_categories", Int32Array, $8, num_seqs);
+      emp.StateSeqBindColumn(data, "seq_ids", Int32Array, $9, num_seqs);
+      data["num_states"] = num_states;
+      data["num_seqs"] = num_seqs;
+      // Per-category domains.
+      data["domains"] = {};
+      for (var c = 0; c < data["categories"].length; c++) {
+        var d = ($10 >> 3) + 4 * c;
+        data["domains"][data["categories"][c]] = ({"x": ([HEAPF64[d], HEAPF64[d+1]]),
+                                                  "y": ([HEAPF64[d+2], HEAPF64[d+3]])});
+      }
+    }, GetID().c_str(), dataset.GetNumStates(), dataset.GetNumSequences(),
+       dataset.GetStates().data(), dataset.GetStarts().data(), dataset.GetDurations().data(),
+       dataset.GetSequenceBegins().data(), dataset.GetSequenceLengths().data(),
+       dataset.GetSequenceCategories().data(), dataset.GetSequenceIDs().data(),
+       domain_values.data()
+    );
+    // Per-category sequence index.
+    for (size_t cat = 0; cat < dataset.GetNumCategories(); ++cat) {
+      const auto & seqs = dataset.GetCategorySequences((StateSequenceDataset::code_t) cat);
+      EM_ASM_ARGS({
+        var data = emp.StateSeqVis[Pointer_stringify($0)]["data"];
+        emp.StateSeqBindColumn(data["category_seqs"], $1, Uint32Array, $2, $3);
+        data["category_counts"][$1] = $3;
+      }, GetID().c_str(), cat, seqs.data(), seqs.size());
+    }
+    source->interval_index.Update(dataset);
+    source->extended = dataset.GetExtendedSequences();
+    for (auto seq : source->extended) source->interval_index.UpdateSequence(dataset, seq);
+    dataset.ClearExtendedSequences();
+    STATE_SEQ_PROFILE( EndPhase(timer, dataset.GetNumSequences() - source->exported_seqs, dataset.GetNumStates() - source->exported_states); )
+    source->exported_seqs = dataset.GetNumSequences();
+    source->exported_states = dataset.GetNumStates();
+    source->exported_state_names = dataset.GetStateNames().size();
+    source->exported_seqIDs = dataset.GetSequenceIDDictionary().size();
+    source->exported_categories = dataset.GetNumCategories();
+  }
+
+  /// Internal function called (from JS) with the next chunk of a streaming CSV load sitting in the heap.
+  /// Returns false if the load should be aborted.
+  bool FeedCSVChunk(uint32_t buffer, uint32_t size) {
+    STATE_SEQ_PROFILE( StateSequenceProfiler::Timer timer(StateSequenceProfiler::Phase::PARSE); )
+    STATE_SEQ_PROFILE( const size_t old_seqs = source->dataset.GetNumSequences(); )
+    STATE_SEQ_PROFILE( const size_t old_states = source->dataset.GetNumStates(); )
+    if (!csv_stream.Feed(source->dataset, reinterpret_cast<const char *>(buffer), size)) {
+      SourceFailed(csv_stream.GetError());
+      return false;
+    }
+    source->file_offset += size;
+    STATE_SEQ_PROFILE( EndPhase(timer, source->dataset.GetNumSequences() - old_seqs, source->dataset.GetNumStates() - old_states); )
+    if (source->dataset.GetNumSequences() > source->exported_seqs) PublishData();
+    return true;
+  }
+
+  /// Internal function called (from JS) at the end of a streaming CSV load, fetch_time seconds after
+  /// the download started.
+  void FinishCSV(double fetch_time) {
+    STATE_SEQ_PROFILE( EndPhase(StateSequenceProfiler::Phase::FETCH, fetch_time, 0, csv_stream.GetNumLines()); )
+    STATE_SEQ_PROFILE( StateSequenceProfiler::Timer timer(StateSequenceProfiler::Phase::PARSE); )
+    STATE_SEQ_PROFILE( const size_t old_seqs = source->dataset.GetNumSequences(); )
+    STATE_SEQ_PROFILE( const size_t old_states = source->dataset.GetNumStates(); )
+    if (!csv_stream.Finish(source->dataset)) {
+      SourceFailed(csv_stream.GetError());
+      return;
+    }
+    STATE_SEQ_PROFILE( EndPhase(timer, source->dataset.GetNumSequences() - old_seqs, source->dataset.GetNumStates() - old_states); )
+    OpenLiveStream();
+    PublishData();
+    PublishFinished();
+  }
+
+  /// Internal function called (from JS) with the raw contents of a CSV file sitting in the heap,
+  /// fetch_time seconds after the download started. Compressed contents are decompressed into the
+  /// parser a piece at a time (never all at once). The parser's state carries over to appends.
+  void LoadCSVBuffer(uint32_t buffer, uint32_t size, double fetch_time) {
+    STATE_SEQ_PROFILE( EndPhase(StateSequenceProfiler::Phase::FETCH, fetch_time, 0, size); )
+    STATE_SEQ_PROFILE( StateSequenceProfiler::Timer timer(StateSequenceProfiler::Phase::PARSE); )
+    StateSequenceDataset::Schema schema(state_seq_cname, state_starts_cname, state_durations_cname,
+                                        category_cname, seqID_cname, seq_delim);
+    const char * text = reinterpret_cast<const char *>(buffer);
+    csv_stream.Reset(schema);
+    source->dataset.Clear();
+    if (!csv_stream.Feed(source->dataset, text, size) || !csv_stream.Finish(source->dataset)) {
+      SourceFailed(csv_stream.GetError());
+      return;
+    }
+    source->file_offset = size;
+    STATE_SEQ_PROFILE( EndPhase(timer, source->dataset.GetNumSequences(), source->dataset.GetNumStates()); )
+    OpenLiveStream();
+    PublishData();
+    PublishFinished();
+  }
+
+  /// Internal function to get our source ready for appends once its CSV data has been read: appended
+  /// records are parsed with the loaded file's columns (see AppendCSVData).
+  void OpenLiveStream() {
+    source->live_stream.Continue(csv_stream, true);
+    source->compressed = (csv_stream.GetFormat() != StateSequenceDecompressor::Format::PLAIN);
+  }
+
+  /// Internal function called (from C++ or JS) with CSV records to append to our (loaded) source.
+  /// Records may start or end mid-line (partial lines are held until the rest arrives); records for a
+  /// sequence ID already in their category extend that sequence. Only what changed is exported, and
+  /// views only redraw the affected sequences. Returns false (see GetAppendError) if the records
+  /// could not be appended; records before the failure are kept, and later appends keep failing.
+  /// Only text read from the source file (from_file) moves the offset that following it resumes at.
+  bool AppendCSVData(const char * text, size_t size, bool from_file) {
+    if (source->status != Source::Status::LOADED || !source->live_stream.HasHeader()) {
+      append_error = "Only loaded CSV data can be appended to.";
+      return false;
+    }
+    STATE_SEQ_PROFILE( StateSequenceProfiler::Timer timer(StateSequenceProfiler::Phase::PARSE); )
+    auto & dataset = source->dataset;
+    STATE_SEQ_PROFILE( const size_t old_seqs = dataset.GetNumSequences(); )
+    STATE_SEQ_PROFILE( const size_t old_states = dataset.GetNumStates(); )
+    const bool ok = source->live_stream.Feed(dataset, text, size);
+    append_error = ok ? "" : source->live_stream.GetError();
+    if (ok && from_file) source->file_offset += size;
+    STATE_SEQ_PROFILE( EndPhase(timer, dataset.GetNumSequences() - old_seqs, dataset.GetNumStates() - old_states); )
+    if (dataset.GetNumSequences() > source->exported_seqs || !dataset.GetExtendedSequences().empty()) PublishData();
+    return ok;
+  }
+
+  /// Internal function called (from JS) with the contents of a binary data file sitting in the heap,
+  /// fetch_time seconds after the download started.
+  void LoadBinaryBuffer(uint32_t buffer, uint32_t size, double fetch_time) {
+    STATE_SEQ_PROFILE( EndPhase(StateSequenceProfiler::Phase::FETCH, fetch_time, 0, size); )
+    STATE_SEQ_PROFILE( StateSequenceProfiler::Timer timer(StateSequenceProfiler::Phase::PARSE); )
+    StateSequenceBinaryView view;
+    bool ok = view.Open(reinterpret_cast<const void *>(buffer), size);
+    std::string error = view.GetError();
+    if (ok) {
+      ok = view.ToDataset(source->dataset);
+      error = source->dataset.GetError();
+    }
+    if (!ok) {
+      SourceFailed(error);
+      return;
+    }
+    STATE_SEQ_PROFILE( EndPhase(timer, source->dataset.GetNumSequences(), source->dataset.GetNumStates()); )
+    PublishData();
+    PublishFinished();
+  }
+
+  /// Internal load data from binary function given the filename where data is stored.
+  /// (Data somebody else has already loaded, or is loading, is shared rather than loaded again.)
+  void LoadDataFromBinaryInternal(std::string filename) {
+    csv_filename.clear();
+    if (!OpenSource(StateSequenceDatasetStore::MakeKey("binary:" + filename))) {
+      JoinSource();
+      return;
+    }
     EM_ASM_ARGS({
       var vis_obj_id = Pointer_stringify($0);
       var filename = Pointer_stringify($1);
-      var state_seq_cname = Pointer_stringify($2);
-      var state_starts_cname = Pointer_stringify($3);
-      var state_durations_cname = Pointer_stringify($4);
-      var category_cname = Pointer_stringify($5);
-      var seqID_cname = Pointer_stringify($6);
-      var seq_delim = Pointer_stringify($7);
+      var LoadBinaryBuffer = emp[vis_obj_id+"_load_binary_buffer"];
+      var token = emp.StateSeqVis[vis_obj_id]["load_token"];
+      var Current = function() { return emp.StateSeqVis[vis_obj_id]["load_token"] === token; };
+      var Fail = function() {
+        if (Current()) emp[vis_obj_id+"_source_failed"]("Unable to fetch " + filename + ".");
+      };
 
-      var vis = emp.StateSeqVis[vis_obj_id];
-      vis["categories"] = [];
-      vis["seqs_by_category"] = {};
-      vis["domains"] = {};
-
-      // Max/min sequence values. (for y domain calculations).
-      var max_seq = null;
-      var min_seq = null;
-
-      var DataAccessor = function(row) {
-        var states = row[state_seq_cname].split(seq_delim);
-        var state_starts = row[state_starts_cname].split(seq_delim).map(Number);
-        var state_durations = row[state_durations_cname].split(seq_delim).map(Number);
-        var category = row[category_cname];
-        var seq_id = row[seqID_cname];
-        var state_sequence = [];
-
-        // Build up a list of categories.
-        if (vis["categories"].indexOf(category) == -1) {
-          vis["seqs_by_category"][category] = [];
-          vis["domains"][category] = ({"y": ([state_starts[0], state_starts[0] + state_durations[0]]),
-                                      "x": ([0, 0])});
-          vis["categories"].push(category);
-        }
-        //   Ensure that seq_ids are unique within a category.
-        if (vis["seqs_by_category"][category].indexOf(seq_id) == -1) {
-          vis["seqs_by_category"][category].push(seq_id);
+      var fetch_start = Date.now();
+      var request = new XMLHttpRequest();
+      request.open("GET", filename, true);
+      request.responseType = "arraybuffer";
+      request.onload = function() {
+        if (!Current()) return;
+        if (request.status >= 400 || !request.response) {
+          Fail();
+          return;
         }
-        vis["domains"][category]["x"][1] += 1;
-        for (i = 0; i < states.length; i++) {
-          if (vis["domains"][category]["y"][1] < (state_starts[i] + state_durations[i])) {
-            vis["domains"][category]["y"][1] = state_starts[i] + state_durations[i];
-          }
-          if (vis["domains"][category]["y"][0] > state_starts[i]) {
-            vis["domains"][category]["y"][0] = state_starts[i];
+        // One copy of the whole file into the heap; the native side reads it in place.
+        var bytes = new Uint8Array(request.response);
+        var buffer = _malloc(bytes.length);
+        HEAPU8.set(bytes, buffer);
+        bytes = null;
+        LoadBinaryBuffer(buffer, request.response.byteLength, (Date.now() - fetch_start) / 1000);
+        _free(buffer);
+      };
+      request.onerror = Fail;
+      request.send();
+    }, GetID().c_str(), filename.c_str());
+  }
+
+  /// Internal load data from CSV function given the filename where data is stored.
+  /// (Data somebody else has already loaded, or is loading, with the same schema is shared rather
+  /// than loaded again.)
+  void LoadDataFromCSV(std::string filename) {
+    const StateSequenceDataset::Schema schema(state_seq_cname, state_starts_cname, state_durations_cname,
+                                              category_cname, seqID_cname, seq_delim);
+    csv_filename = filename;
+    if (!OpenSource(StateSequenceDatasetStore::MakeKey("csv:" + filename, schema))) {
+      JoinSource();
+      return;
+    }
+    csv_stream.Reset(schema);
+    EM_ASM_ARGS({
+      var vis_obj_id = Pointer_stringify($0);
+      var filename = Pointer_stringify($1);
+      var streaming = $2;
+      var chunk_size = $3;
+      var LoadCSVBuffer = emp[vis_obj_id+"_load_csv_buffer"];
+      var FeedCSVChunk = emp[vis_obj_id+"_feed_csv_chunk"];
+      var FinishCSV = emp[vis_obj_id+"_finish_csv"];
+      // Another load (by this visualization) may start before this one is done; this one then stops.
+      var token = emp.StateSeqVis[vis_obj_id]["load_token"];
+      var Current = function() { return emp.StateSeqVis[vis_obj_id]["load_token"] === token; };
+      var Fail = function() {
+        if (Current()) emp[vis_obj_id+"_source_failed"]("Unable to fetch " + filename + ".");
+      };
+      var fetch_start = Date.now();
+
+      if (streaming && window.fetch && window.ReadableStream) {
+        // Stream the file through a fixed-size heap buffer; records are parsed (and drawn) as they arrive.
+        var buffer = _malloc(chunk_size);
+        var Release = function() {
+          if (buffer) _free(buffer);
+          buffer = 0;
+        };
+        var Feed = function(bytes) {
+          for (var pos = 0; pos < bytes.length; pos += chunk_size) {
+            var piece = bytes.subarray(pos, Math.min(pos + chunk_size, bytes.length));
+            HEAPU8.set(piece, buffer);
+            if (!FeedCSVChunk(buffer, piece.length)) return false;
           }
-          state_sequence.push({state: states[i], duration: state_durations[i], start: state_starts[i]});
+          return true;
+        };
+        fetch(filename).then(function(response) {
+          if (!response.ok || !response.body) throw new Error(response.statusText);
+          var reader = response.body.getReader();
+          var Pump = function(result) {
+            if (!Current()) {
+              Release();
+              reader.cancel();
+              return;
+            }
+            if (result.done) {
+              Release();
+              FinishCSV((Date.now() - fetch_start) / 1000);
+              return;
+            }
+            if (!Feed(result.value)) {
+              Release();
+              reader.cancel();
+              return;
+            }
+            return reader.read().then(Pump);
+          };
+          return reader.read().then(Pump);
+        }).catch(function(error) {
+          Release();
+          Fail();
+        });
+        return;
+      }
+
+      // Fetched as raw bytes (the file may be compressed; see StateSequenceDecompressor).
+      var request = new XMLHttpRequest();
+      request.open("GET", filename, true);
+      request.responseType = "arraybuffer";
+      request.onload = function() {
+        if (!Current()) return;
+        if (request.status >= 400 || !request.response) {
+          Fail();
+          return;
         }
-        var ret_obj = {};
-        ret_obj["category"] = category;
-        ret_obj["sequence_id"] = seq_id;
-        ret_obj["state_sequence"] = state_sequence;
-        return ret_obj;
+        // Copy the file into the heap and let the native parser take it from there.
+        var bytes = new Uint8Array(request.response);
+        var buffer = _malloc(Math.max(1, bytes.length));
+        HEAPU8.set(bytes, buffer);
+        LoadCSVBuffer(buffer, bytes.length, (Date.now() - fetch_start) / 1000);
+        _free(buffer);
       };
+      request.onerror = Fail;
+      request.send();
+    }, GetID().c_str(), filename.c_str(), streaming_load, stream_chunk_size);
+  }
 
-      // Capture data exists to capture data from callback.
-      var DataCallback = function(data) {
-        if (vis["categories"].length == 0) {
-          alert("Can't find categories for " + vis_obj_id + "! It's likely nothing will work");
-        }
-        // Capture data, setup data-dependent variables.
-        vis["data"] = data;
+  /// Internal function to fit [lo, hi] into [min, max], shifting it if it fits and clipping it if not.
+  static void ClampRange(double & lo, double & hi, double min, double max) {
+    if (hi - lo >= max - min) {
+      lo = min;
+      hi = max;
+      return;
+    }
+    if (lo < min) { hi += min - lo; lo = min; }
+    if (hi > max) { lo -= hi - max; hi = max; }
+  }
 
-        emp_i.__outgoing_array = vis["categories"];
-        emp[vis_obj_id+"_data_callback"]();
-      };
+  /// Internal function to get the part of the current category in view: the viewport (fit into the
+  /// category's domain) if one has been set, or else the whole domain.
+  StateSequenceDataset::Domain GetViewDomain() const {
+    const auto & domain = source->dataset.GetDomain(source->dataset.GetCategoryCode(cur_category));
+    if (!zoomed) return domain;
+    StateSequenceDataset::Domain view(viewport);
+    ClampRange(view.x_min, view.x_max, domain.x_min, domain.x_max);
+    ClampRange(view.y_min, view.y_max, domain.y_min, domain.y_max);
+    if (!(view.x_min < view.x_max && view.y_min < view.y_max)) return domain;
+    return view;
+  }
+
+  /// Internal function to check whether only part of the current category is in view.
+  bool IsCulling() const {
+    return zoomed && !(GetViewDomain() == source->dataset.GetDomain(source->dataset.GetCategoryCode(cur_category)));
+  }
+
+  /// Internal function to check whether sequences are drawn in some order other than file order.
+  bool IsOrdered() const { return sequence_order != SequenceOrder::FILE; }
 
-      d3.csv(filename, DataAccessor, DataCallback);
+  /// Internal function to get the sequences of the current category in display order (position p
+  /// on the x axis shows sequence GetDisplaySequences()[p]).
+  const emp::vector<StateSequenceDataset::index_t> & GetDisplaySequences() const {
+    const auto cat = source->dataset.GetCategoryCode(cur_category);
+    if (!IsOrdered()) return source->dataset.GetCategorySequences(cat);
+    return ordering.Get(source->dataset, cat);
+  }
+
+  /// Internal function to get the range [first, last) of sequence positions (within the current
+  /// category) that fall into view. (The sequence at position p spans [p, p + 0.9].)
+  void GetViewSequences(const StateSequenceDataset::Domain & view, size_t & first, size_t & last) const {
+    const size_t num_seqs = source->dataset.GetCategorySequences(source->dataset.GetCategoryCode(cur_category)).size();
+    last = std::min(num_seqs, (size_t) std::max(0.0, std::floor(view.x_max) + 1.0));
+    first = std::min(last, (size_t) std::max(0.0, std::floor(view.x_min)));
+  }
 
+  /// Internal function to get the part of the current category in view, binned at lod_bin_size.
+  StateSequenceLOD::Viewport GetLODViewport() const {
+    const auto view = GetViewDomain();
+    size_t first = 0;
+    size_t last = 0;
+    GetViewSequences(view, first, last);
+    const double canvas_width = GetForRealWidth() - margins.left - margins.right;
+    const double canvas_height = GetForRealHeight() - margins.top - margins.bottom;
+    return StateSequenceLOD::Viewport(first, last, view.y_min, view.y_max,
+                                      (size_t) std::max(1.0, canvas_width / lod_bin_size),
+                                      (size_t) std::max(1.0, canvas_height / lod_bin_size));
+  }
+
+  /// Internal function to decide whether the current category should be drawn as a level-of-detail summary.
+  bool UseLOD() const {
+    if (lod_mode == LODMode::OFF) return false;
+    if (lod_mode == LODMode::ALWAYS) return true;
+    return !StateSequenceLOD::IsResolvable(source->dataset, GetDisplaySequences(), GetLODViewport(),
+                                           &source->interval_index);
+  }
+
+  /// Internal function to draw the current category as a level-of-detail summary: one rect per run of
+  /// equally dominated bins, so the element count is bounded by the canvas area.
+  void DrawLOD() {
+    const auto view = GetViewDomain();
+    lod.Build(source->dataset, GetDisplaySequences(), GetLODViewport(), &source->interval_index);
+    lod_active = true;
+    EM_ASM_ARGS({
+      var vis = emp.StateSeqVis[Pointer_stringify($0)];
+      var x_domain = ([$1, $2]);
+      var y_domain = ([$3, $4]);
+      var runs = $5 >> 3;
+      var num_runs = $6;
+      var size = vis["LayoutFrame"](x_domain, y_domain);
+
+      // The detailed subtree (if any) goes back into the render cache while the summary is up.
+      vis["DeactivateCategory"]();
+      vis["EvictRenderCache"]();
+      vis["ClearLayer"]("view");
+      var lod = vis["Layer"]("lod");
+      lod["group"].selectAll("*").remove();
+      var state_names = vis["data"]["state_names"];
+      lod["group"].selectAll("rect").data(d3.range(num_runs)).enter().append("rect")
+        .attr({"class": function(r) { return state_names[HEAPF64[runs + 5 * r + 4]]; },
+               "x": function(r) { return HEAPF64[runs + 5 * r]; },
+               "y": function(r) { return HEAPF64[runs + 5 * r + 2]; },
+               "width": function(r) { return HEAPF64[runs + 5 * r + 1] - HEAPF64[runs + 5 * r]; },
+               "height": function(r) { return HEAPF64[runs + 5 * r + 3] - HEAPF64[runs + 5 * r + 2]; },
+               "fill": "grey"
+             });
+      vis["PositionGroup"](lod, x_domain, y_domain, size[0], size[1]);
     }, GetID().c_str(),
-       filename.c_str(),
-       state_seq_cname.c_str(),
-       state_starts_cname.c_str(),
-       state_durations_cname.c_str(),
-       category_cname.c_str(),
-       seqID_cname.c_str(),
-       seq_delim.c_str()
+       view.x_min, view.x_max, view.y_min, view.y_max,
+       lod.GetRuns().data(),
+       lod.GetNumRuns()
+    );
+  }
+
+  /// Internal function to collect (into states/positions) every state of the current category that
+  /// overlaps view, along with the sequence position it is drawn at. Candidates come from the
+  /// interval index.
+  void CollectStates(const StateSequenceDataset::Domain & view,
+                     emp::vector<StateSequenceDataset::index_t> & states,
+                     emp::vector<StateSequenceDataset::index_t> & positions) const {
+    using index_t = StateSequenceDataset::index_t;
+    const auto & seqs = GetDisplaySequences();
+    size_t first_pos = 0;
+    size_t last_pos = 0;
+    GetViewSequences(view, first_pos, last_pos);
+    states.clear();
+    positions.clear();
+    for (size_t pos = first_pos; pos < last_pos; ++pos) {
+      size_t first = 0;
+      size_t last = 0;
+      source->interval_index.FindCandidates(source->dataset, seqs[pos], view.y_min, view.y_max, first, last);
+      for (size_t k = first; k < last; ++k) {
+        if (!StateSequenceIntervalIndex::Overlaps(source->dataset, k, view.y_min, view.y_max)) continue;
+        states.push_back((index_t) k);
+        positions.push_back((index_t) pos);
+      }
+    }
+  }
+
+  /// Internal function to collect (into view_states/view_positions) every state of the current
+  /// category that overlaps view.
+  void CollectViewStates(const StateSequenceDataset::Domain & view) {
+    CollectStates(view, view_states, view_positions);
+  }
+
+  /// Internal function to draw the states of the current category that overlap the viewport (and
+  /// nothing else). Candidates are found with the interval index, so the cost follows what is visible.
+  void DrawViewport() {
+    const auto view = GetViewDomain();
+    CollectViewStates(view);
+    lod_active = false;
+    EM_ASM_ARGS({
+      var vis = emp.StateSeqVis[Pointer_stringify($0)];
+      var x_domain = ([$1, $2]);
+      var y_domain = ([$3, $4]);
+      var states = $5 >> 2;
+      var positions = $6 >> 2;
+      var count = $7;
+      var size = vis["LayoutFrame"](x_domain, y_domain);
+
+      vis["DeactivateCategory"]();
+      vis["EvictRenderCache"]();
+      vis["ClearLayer"]("lod");
+      var layer = vis["Layer"]("view");
+      layer["group"].attr({"stroke": "white", "stroke-width": 0.5});
+      layer["group"].selectAll("*").remove();
+      var data = vis["data"];
+      var visible = Array.prototype.slice.call(HEAPU32.subarray(states, states + count));
+      layer["group"].selectAll("rect").data(visible).enter().append("rect")
+        .attr({"class": function(k) { return data["state_names"][data["states"][k]]; },
+               "x": function(k, i) { return HEAPU32[positions + i]; },
+               "y": function(k) { return data["starts"][k]; },
+               "height": function(k) { return data["durations"][k]; },
+               "width": vis["sequence_width"],
+               "fill": "grey",
+               "vector-effect": "non-scaling-stroke"
+             });
+      vis["PositionGroup"](layer, x_domain, y_domain, size[0], size[1]);
+    }, GetID().c_str(),
+       view.x_min, view.x_max, view.y_min, view.y_max,
+       view_states.data(),
+       view_positions.data(),
+       view_states.size()
+    );
+  }
+
+  /// Internal function to draw every sequence of the current category (reusing its cached subtree if
+  /// there is one).
+  void DrawCategory() {
+    const auto view = GetViewDomain();
+    lod_active = false;
+    const int stale = EM_ASM_INT({
+      var cur_category = Pointer_stringify($1);
+      var vis = emp.StateSeqVis[Pointer_stringify($0)];
+      var x_domain = ([$2, $3]);
+      var y_domain = ([$4, $5]);
+      var size = vis["LayoutFrame"](x_domain, y_domain);
+
+      // Swap in this category's subtree (reusing a cached one if we have it).
+      vis["ClearLayer"]("lod");
+      vis["ClearLayer"]("view");
+      var data_canvas = d3.select("#StateSequenceVisualization-data_canvas-" + Pointer_stringify($0));
+      var entry = vis["ActivateCategory"](data_canvas, cur_category);
+      vis["PositionGroup"](entry, x_domain, y_domain, size[0], size[1]);
+      if (entry["drawn_count"] >= 0) {
+        // Cached subtree: only needs work if sequences have been loaded since it was drawn.
+        return (entry["drawn_count"] != vis["CategorySize"](cur_category)) ? 1 : 0;
+      }
+      var seqs = vis["CategorySequences"](cur_category, 0);
+      entry["elements"] += vis["AppendSequences"](entry, seqs, 0);
+      entry["drawn_count"] = seqs.length;
+      return 0;
+    }, GetID().c_str(),
+       cur_category.c_str(),
+       view.x_min, view.x_max, view.y_min, view.y_max
+    );
+    if (stale) DrawNewSequences();
+  }
+
+  /// Internal function to group rects (x, y, width, height, state) by state into canvas_rects and
+  /// canvas_groups (a counting sort over state codes).
+  void GroupCanvasRects(const emp::vector<double> & rects) {
+    const size_t num_rects = rects.size() / 5;
+    emp::vector<size_t> offsets(source->dataset.GetStateNames().size() + 1, 0);
+    for (size_t r = 0; r < num_rects; ++r) ++offsets[(size_t) rects[5 * r + 4] + 1];
+    canvas_groups.clear();
+    for (size_t state = 0; state + 1 < offsets.size(); ++state) {
+      if (offsets[state + 1] > 0) {
+        canvas_groups.insert(canvas_groups.end(),
+                             { (int32_t) state, (int32_t) offsets[state], (int32_t) offsets[state + 1] });
+      }
+      offsets[state + 1] += offsets[state];
+    }
+    canvas_rects.resize(4 * num_rects);
+    for (size_t r = 0; r < num_rects; ++r) {
+      const size_t dest = 4 * offsets[(size_t) rects[5 * r + 4]]++;
+      std::copy(rects.begin() + 5 * r, rects.begin() + 5 * r + 4, canvas_rects.begin() + dest);
+    }
+  }
+
+  /// Internal function to draw the current view on the canvas backend: the level-of-detail summary
+  /// or the visible states, painted in one fill pass per state.
+  void DrawCanvas() {
+    const auto view = GetViewDomain();
+    emp::vector<double> rects;
+    const bool use_lod = UseLOD();
+    if (use_lod) {
+      lod.Build(source->dataset, GetDisplaySequences(), GetLODViewport(), &source->interval_index);
+      const auto & runs = lod.GetRuns();
+      rects.reserve(runs.size());
+      for (size_t r = 0; r < runs.size(); r += StateSequenceLOD::RUN_FIELDS) {
+        rects.insert(rects.end(), { runs[r], runs[r + 2], runs[r + 1] - runs[r], runs[r + 3] - runs[r + 2], runs[r + 4] });
+      }
+    } else {
+      CollectViewStates(view);
+      const auto & states = source->dataset.GetStates();
+      const auto & starts = source->dataset.GetStarts();
+      const auto & durations = source->dataset.GetDurations();
+      rects.reserve(5 * view_states.size());
+      for (size_t i = 0; i < view_states.size(); ++i) {
+        const size_t k = view_states[i];
+        rects.insert(rects.end(), { (double) view_positions[i], starts[k], StateSequenceLayout::SEQUENCE_WIDTH,
+                                    durations[k], (double) states[k] });
+      }
+    }
+    lod_active = use_lod;
+    GroupCanvasRects(rects);
+    EM_ASM_ARGS({
+      var vis = emp.StateSeqVis[Pointer_stringify($0)];
+      vis["PaintCanvas"](([$1, $2]), ([$3, $4]), $5 >> 3, $6 >> 2, $7, $8);
+    }, GetID().c_str(),
+       view.x_min, view.x_max, view.y_min, view.y_max,
+       canvas_rects.data(),
+       canvas_groups.data(),
+       canvas_groups.size() / 3,
+       !use_lod
+    );
+  }
+
+  /// Internal function to draw (or hide) the state-frequency panel: a stacked area chart of the
+  /// fraction of the current category's sequences in each state over the time span in view, with
+  /// one sample per vertical pixel. It shares the data area's time axis.
+  void DrawFrequency() {
+    if (!show_frequency) {
+      EM_ASM_ARGS({
+        d3.select("#StateSequenceVisualization-frequency-" + Pointer_stringify($0))
+          .style("display", "none").selectAll("*").remove();
+      }, GetID().c_str());
+      return;
+    }
+    const auto view = GetViewDomain();
+    const double canvas_height = GetForRealHeight() - margins.top - margins.bottom;
+    const auto cat = source->dataset.GetCategoryCode(cur_category);
+    frequency.Sample(source->dataset, cat, view.y_min, view.y_max, (size_t) std::max(1.0, std::floor(canvas_height)));
+    const auto & states = frequency.GetStates(source->dataset, cat);
+    EM_ASM_ARGS({
+      var obj_id = Pointer_stringify($0);
+      var vis = emp.StateSeqVis[obj_id];
+      var samples = $1 >> 3;
+      var rows = $2;
+      var states = $3 >> 2;
+      var num_states = $4;
+      var panel_width = $5;
+      var margins = vis["margins"];
+      var width = emp[obj_id+"_get_width"]() - margins.left - margins.right;
+      var height = emp[obj_id+"_get_height"]() - margins.top - margins.bottom;
+      var panel = d3.select("#StateSequenceVisualization-frequency-" + obj_id);
+      panel.attr({"transform": "translate(" + (margins.left + width + $6) + "," + margins.top + ")"})
+           .style("display", null);
+      panel.selectAll("*").remove();
+
+      // stacked[i * rows + r]: fraction of sequences in states before state i during row r.
+      var stacked = new Float64Array((num_states + 1) * rows);
+      for (var i = 0; i < num_states; i++) {
+        for (var r = 0; r < rows; r++) {
+          stacked[(i + 1) * rows + r] = stacked[i * rows + r] + HEAPF64[samples + r * num_states + i];
+        }
+      }
+      var xScale = d3.scale.linear().domain([0, 1]).range([0, panel_width]);
+      var Y = function(r) { return (r + 0.5) * height / rows; };
+      var row_range = d3.range(rows);
+      var state_names = vis["data"]["state_names"];
+      for (var i = 0; i < num_states; i++) {
+        var area = d3.svg.area().y(Y)
+          .x0(function(r) { return xScale(stacked[i * rows + r]); })
+          .x1(function(r) { return xScale(stacked[(i + 1) * rows + r]); });
+        var name = state_names[HEAP32[states + i]];
+        panel.append("path").attr({"class": name, "state": name, "d": area(row_range), "fill": "grey"});
+      }
+      var axis = d3.svg.axis().scale(xScale).ticks(2).orient("top");
+      panel.append("g").attr({"class": "axis frequency_axis"}).call(axis);
+      panel.selectAll(".axis path").style({"fill": "none", "stroke": "black", "shape-rendering": "crispEdges"});
+      panel.selectAll(".axis text").style({"font-family": "sans-serif", "font-size": "10px"});
+    }, GetID().c_str(),
+       frequency.GetSamples().data(),
+       frequency.GetNumRows(),
+       states.data(),
+       states.size(),
+       frequency_width,
+       (double) FREQUENCY_GAP
     );
   }
 
   /// Internal draw function.
   void Draw() {
+    // Check on cur category (make sure it's valid).
+    if (source->dataset.GetCategoryCode(cur_category) == -1) {
+      EM_ASM_ARGS({
+        alert("Failed to find category: " + Pointer_stringify($0) + "\nDisplaying default: " + Pointer_stringify($1));
+      }, cur_category.c_str(), categories[0].c_str());
+      SetCurrentCategoryInternal(categories[0]);
+    }
+    STATE_SEQ_PROFILE( StateSequenceProfiler::Timer timer(StateSequenceProfiler::Phase::DRAW); )
+    data_drawn = true;
+    if (render_backend == RenderBackend::CANVAS) DrawCanvas();
+    else if (UseLOD()) DrawLOD();
+    else if (IsCulling() || IsOrdered()) DrawViewport();
+    else DrawCategory();
+    DrawFrequency();
+    if (!zooming) SyncZoom();
+    STATE_SEQ_PROFILE( EndPhase(timer, source->dataset.GetCategorySequences(source->dataset.GetCategoryCode(cur_category)).size(),
+                                CountDisplayedElements()); )
+  }
+
+  /// Internal function to queue up drawing of newly loaded sequences (at most once per animation frame).
+  void ScheduleDrawNewSequences() {
     EM_ASM_ARGS({
+      var vis_obj_id = Pointer_stringify($0);
+      var vis = emp.StateSeqVis[vis_obj_id];
+      if (vis["draw_new_pending"]) return;
+      vis["draw_new_pending"] = true;
+      window.requestAnimationFrame(function() {
+        vis["draw_new_pending"] = false;
+        emp[vis_obj_id+"_draw_new_sequences"]();
+      });
+    }, GetID().c_str());
+  }
+
+  /// Internal function to add the states appended to extended sequences (see AppendCSVData) to every
+  /// subtree showing them, active or cached. Only the new states are drawn.
+  void PatchExtendedSequences() {
+    if (pending_extended.empty()) return;
+    EM_ASM_ARGS({
+      emp.StateSeqVis[Pointer_stringify($0)]["ExtendSequences"](HEAPU32.subarray($1 >> 2, ($1 >> 2) + $2));
+    }, GetID().c_str(), pending_extended.data(), pending_extended.size());
+    pending_extended.clear();
+  }
+
+  /// Internal function to bring the current view up to date: appends sequences loaded since it was
+  /// drawn (and states appended to ones already drawn), and re-lays out the view (axes + one group
+  /// transform) only if the domain has changed.
+  void DrawNewSequences() {
+    if (!data_drawn) {
+      pending_extended.clear();
+      return;
+    }
+    PatchExtendedSequences();
+    // Canvases, summaries, culled and reordered views are redrawn from scratch (and new data may
+    // change which one is needed).
+    if (render_backend == RenderBackend::CANVAS || lod_active || IsCulling() || IsOrdered() || UseLOD()) {
+      Draw();
+      return;
+    }
+    STATE_SEQ_PROFILE( StateSequenceProfiler::Timer timer(StateSequenceProfiler::Phase::DRAW); )
+    const int layout_changed = EM_ASM_INT({
       var vis_obj_id = Pointer_stringify($0);
       var GetHeight = emp[vis_obj_id+"_get_height"];
       var GetWidth = emp[vis_obj_id+"_get_width"];
-      var SetCurrentCategory = emp[vis_obj_id+"_set_current_category"];
-
       var cur_category = Pointer_stringify($1);
       var margins = ({top: $2, right: $3, bottom: $4, left: $5});
-
-      // Get our handle on this visualization's container.
       var vis = emp.StateSeqVis[vis_obj_id];
+      var entry = vis["active"];
+      if (!entry) return 0;
 
-      // Check on cur category (make sure it's valid).
-      if (vis["categories"].indexOf(cur_category) == -1) {
-        alert("Failed to find category: " + cur_category + "\nDisplaying default: " + vis["categories"][0]);
-        cur_category = vis["categories"][0];
-        SetCurrentCategory(cur_category);
-      }
-
-      var vis_width = GetWidth();
-      var vis_height = GetHeight();
-      var canvas_width = vis_width - margins.left - margins.right;
-      var canvas_height = vis_height - margins.top - margins.bottom;
-
-      var x_domain = vis["domains"][cur_category]["x"];
-      var x_range = ([0, canvas_width]);
-      var y_domain = vis["domains"][cur_category]["y"];
-      var y_range = ([0, canvas_height]);
+      var canvas_width = GetWidth() - margins.left - margins.right;
+      var canvas_height = GetHeight() - margins.top - margins.bottom;
+      var x_domain = vis["data"]["domains"][cur_category]["x"];
+      var y_domain = vis["data"]["domains"][cur_category]["y"];
 
-      var xScale = d3.scale.linear().domain(x_domain).range(x_range);
-      var yScale = d3.scale.linear().domain(y_domain).range(y_range);
-
-      var svg = d3.select("#"+vis_obj_id);
-      svg.attr({"width": vis_width, "height": vis_height});
-      var canvas = d3.select("#StateSequenceVisualization-canvas-" + vis_obj_id);
-      canvas.attr({"transform": "translate(" + margins.left + "," + margins.top + ")"});
-
-      // Attach axes.
-      canvas.selectAll(".y_axis").remove();
-      canvas.selectAll(".x_axis").remove();
-      var xAxis = d3.svg.axis().scale(xScale).tickValues([]).orient("top");
-      var yAxis = d3.svg.axis().scale(yScale).orient("left");
-      canvas.append("g").attr({"class": "axis y_axis",
-                               "id": "StateSequenceVisualization-y_axis-" + vis_obj_id
-                             }).call(yAxis);
-      canvas.append("g").attr({"class": "axis x_axis",
-                               "id": "StateSequenceVisualization-x_axis-" + vis_obj_id
-                              }).call(xAxis);
-      var axes = canvas.selectAll(".axis");
-      axes.selectAll("path").style({"fill": "none", "stroke": "black", "shape-rendering": "crispEdges"});
-      axes.selectAll("text").style({"font-family": "sans-serif", "font-size": "10px"});
-
-      var data_canvas = d3.select("#StateSequenceVisualization-data_canvas-" + vis_obj_id);
-      data_canvas.selectAll("*").remove();
-      var filtered_data = vis["data"].filter(function(d) { return d.category == cur_category; });
-
-      var sequences = data_canvas.selectAll("g").data(filtered_data);
-      sequences.enter().append("g");
-      sequences.attr({"class": "state-sequence-" + vis_obj_id,
-                      "id": function(d) { return d.sequence_id + "_" + vis_obj_id; },
-                      "transform": function(seq, i) {
-                        var x_trans = xScale(i);
-                        var y_trans = yScale(0);
-                        return "translate(" + x_trans + "," + y_trans + ")";
-                      }
-                    });
-
-      sequences.each(function(seq, i) {
-        var states = d3.select(this).selectAll("rect").data(seq.state_sequence);
-        states.enter().append("rect");
-        states.attr({"class": function(info, i) { return info.state; },
-                     "state": function(info, i) { return info.state; },
-                     "start": function(info, i) { return info.start; },
-                     "duration": function(info, i) { return info.duration; },
-                     "transform": function(info, i) {
-                       return "translate(0," + yScale(info.start) + ")";
-                     },
-                     "height": function(info, i) { return yScale(info.duration) - 0.5; },
-                     "width": xScale(0.9),
-                     "fill": "grey"
-                   });
-      });
+      var new_seqs = vis["CategorySequences"](cur_category, entry["drawn_count"]);
+      entry["elements"] += vis["AppendSequences"](entry, new_seqs, entry["drawn_count"]);
+      entry["drawn_count"] += new_seqs.length;
 
+      return vis["LayoutMatches"](entry, x_domain, y_domain, canvas_width, canvas_height) ? 0 : 1;
     }, GetID().c_str(),
        cur_category.c_str(),
        margins.top,
@@ -247,84 +1086,120 @@ protected:
        margins.bottom,
        margins.left
     );
-    data_drawn = true;
+    if (!layout_changed) DrawFrequency();
+    STATE_SEQ_PROFILE( EndPhase(timer, source->dataset.GetCategorySequences(source->dataset.GetCategoryCode(cur_category)).size(),
+                                CountDisplayedElements()); )
+    if (layout_changed) Resize();
+  }
+
+  /// Internal function to queue up a resize (at most one layout per animation frame).
+  void ScheduleResize() {
+    EM_ASM_ARGS({ emp.StateSeqVis[Pointer_stringify($0)]["RequestLayout"](); }, GetID().c_str());
   }
 
   /// Internal function used to resize the visualization to dimensions specified by
-  /// actual_width and actual_height.
+  /// actual_width and actual_height. Sequences are drawn in data units, so this only re-renders
+  /// the axes and updates one group transform (cost is independent of the number of states drawn).
   void Resize() {
     if (!data_drawn) return;
+    STATE_SEQ_PROFILE( StateSequenceProfiler::Timer timer(StateSequenceProfiler::Phase::RESIZE); )
+    // Level-of-detail bins depend on the canvas size, so summaries need a full draw (as do canvases).
+    if (render_backend == RenderBackend::CANVAS || lod_active || UseLOD()) {
+      Draw();
+      STATE_SEQ_PROFILE( EndPhase(timer, source->dataset.GetCategorySequences(source->dataset.GetCategoryCode(cur_category)).size(),
+                                  CountDisplayedElements()); )
+      return;
+    }
+    const auto view = GetViewDomain();
     EM_ASM_ARGS({
-      var vis_obj_id = Pointer_stringify($0);
-      var GetHeight = emp[vis_obj_id+"_get_height"];
-      var GetWidth = emp[vis_obj_id+"_get_width"];
-
-      var cur_category = Pointer_stringify($1);
-      var margins = ({top: $2, right: $3, bottom: $4, left: $5});
+      var vis = emp.StateSeqVis[Pointer_stringify($0)];
+      var x_domain = ([$1, $2]);
+      var y_domain = ([$3, $4]);
+      var size = vis["LayoutFrame"](x_domain, y_domain);
+      if (vis["active"]) vis["PositionGroup"](vis["active"], x_domain, y_domain, size[0], size[1]);
+      if (vis["view"]) vis["PositionGroup"](vis["view"], x_domain, y_domain, size[0], size[1]);
+    }, GetID().c_str(),
+       view.x_min, view.x_max, view.y_min, view.y_max
+    );
+    DrawFrequency();
+    SyncZoom();
+    // Only the axes, one transform and the frequency panel were touched.
+    STATE_SEQ_PROFILE( EndPhase(timer, source->dataset.GetCategorySequences(source->dataset.GetCategoryCode(cur_category)).size(), 1); )
+  }
 
-      // Get our handle on this visualization's container.
-      var vis = emp.StateSeqVis[vis_obj_id];
+  /// Internal function to re-base the zoom behavior on the current view. (Called whenever the view
+  /// changes by any means other than a zoom gesture.)
+  void SyncZoom() {
+    const auto view = GetViewDomain();
+    EM_ASM_ARGS({
+      emp.StateSeqVis[Pointer_stringify($0)]["ResetZoom"]([$1, $2, $3, $4]);
+    }, GetID().c_str(), view.x_min, view.x_max, view.y_min, view.y_max);
+  }
 
-      var vis_width = GetWidth();
-      var vis_height = GetHeight();
-      var canvas_width = vis_width - margins.left - margins.right;
-      var canvas_height = vis_height - margins.top - margins.bottom;
+  /// Internal function called (from JS, at most once per animation frame) as the user zooms or pans.
+  void ZoomTo(double x_min, double x_max, double y_min, double y_max) {
+    viewport = StateSequenceDataset::Domain(x_min, x_max, y_min, y_max);
+    zoomed = true;
+    if (!data_drawn) return;
+    zooming = true;
+    Draw();
+    zooming = false;
+  }
 
-      var x_domain = vis["domains"][cur_category]["x"];
-      var x_range = ([0, canvas_width]);
-      var y_domain = vis["domains"][cur_category]["y"];
-      var y_range = ([0, canvas_height]);
+  /// Internal function called (from JS) to put the statistics of category (see GetStatistics) in
+  /// vis["statistics"], as copies: the category's states (codes and names), counts and occupancy per
+  /// state, and the transition matrix (row-major, from x to, in the same state order). Unknown
+  /// categories give null.
+  void ExportStatistics(const std::string & category) {
+    const auto cat = source->dataset.GetCategoryCode(category);
+    if (cat == -1) {
+      EM_ASM_ARGS({ emp.StateSeqVis[Pointer_stringify($0)]["statistics"] = null; }, GetID().c_str());
+      return;
+    }
+    const auto & summary = statistics.Get(source->dataset, cat);
+    // Counts cross as doubles (exact up to 2^53).
+    emp::vector<double> counts(summary.transitions.begin(), summary.transitions.end());
+    counts.insert(counts.end(), summary.visits.begin(), summary.visits.end());
+    EM_ASM_ARGS({
+      var vis = emp.StateSeqVis[Pointer_stringify($0)];
+      var counts = $2 >> 3;
+      var occupancy = $3 >> 3;
+      var states = $4 >> 2;
+      var n = $5;
+      var Copy = function(first, size) { return new Float64Array(HEAPF64.subarray(first, first + size)); };
+      var codes = new Int32Array(HEAP32.subarray(states, states + n));
+      var stats = ({"category": Pointer_stringify($1), "num_seqs": $6, "num_states": n, "states": codes,
+                    "state_names": Array.prototype.map.call(codes, function(code) {
+                      return vis["data"]["state_names"][code];
+                    }),
+                    "transitions": Copy(counts, n * n), "visits": Copy(counts + n * n, n),
+                    "occupancy": Copy(occupancy, n), "mean_dwell": new Float64Array(n)});
+      for (var s = 0; s < n; s++) {
+        if (stats["visits"][s] > 0) stats["mean_dwell"][s] = stats["occupancy"][s] / stats["visits"][s];
+      }
+      vis["statistics"] = stats;
+    }, GetID().c_str(), category.c_str(), counts.data(), summary.occupancy.data(), summary.states.data(),
+       summary.GetNumStates(), summary.num_seqs);
+  }
 
-      var xScale = d3.scale.linear().domain(x_domain).range(x_range);
-      var yScale = d3.scale.linear().domain(y_domain).range(y_range);
+  /// Internal function to get the current view's geometry (data area, scales).
+  StateSequenceLayout GetLayout() const {
+    return StateSequenceLayout(GetForRealWidth(), GetForRealHeight(), GetViewDomain(), margins);
+  }
 
-      var svg = d3.select("#"+vis_obj_id);
-      svg.attr({"width": vis_width, "height": vis_height});
-      var canvas = d3.select("#StateSequenceVisualization-canvas-" + vis_obj_id);
-      canvas.attr({"transform": "translate(" + margins.left + "," + margins.top + ")"});
-
-      // Remove and re-attach axes.
-      canvas.selectAll(".y_axis").remove();
-      canvas.selectAll(".x_axis").remove();
-      var xAxis = d3.svg.axis().scale(xScale).tickValues([]).orient("top");
-      var yAxis = d3.svg.axis().scale(yScale).orient("left");
-      canvas.append("g").attr({"class": "axis y_axis",
-                               "id": "StateSequenceVisualization-y_axis-" + vis_obj_id
-                             }).call(yAxis);
-      canvas.append("g").attr({"class": "axis x_axis",
-                               "id": "StateSequenceVisualization-x_axis-" + vis_obj_id
-                              }).call(xAxis);
-      var axes = canvas.selectAll(".axis");
-      axes.selectAll("path").style({"fill": "none", "stroke": "black", "shape-rendering": "crispEdges"});
-      axes.selectAll("text").style({"font-family": "sans-serif", "font-size": "10px"});
-
-
-      var data_canvas = d3.select("#StateSequenceVisualization-data_canvas-" + vis_obj_id);
-      var sequences = data_canvas.selectAll(".state-sequence-"+vis_obj_id);
-      sequences.attr({"transform": function(seq, i) {
-                        var x_trans = xScale(i);
-                        var y_trans = yScale(0);
-                        return "translate(" + x_trans + "," + y_trans + ")";
-                      }
-                    });
-
-      sequences.each(function(seq, i) {
-        var states = d3.select(this).selectAll("rect");
-        states.attr({"transform": function(info, i) {
-                       return "translate(0," + yScale(info.start) + ")";
-                     },
-                     "height": function(info, i) { return yScale(info.duration) - 0.5; },
-                     "width": xScale(0.9)
-                   });
-      });
+  /// Internal function called (from JS, at most once per animation frame) as the mouse moves over
+  /// the visualization. The hover callback only hears about changes of the state under the mouse.
+  void PointerMoved(double x, double y) {
+    if (!hover_fun) return;
+    const Hit hit = QueryAt(x, y);
+    if (hit.found == hover_hit.found && (!hit.found || hit.state == hover_hit.state)) return;
+    hover_hit = hit;
+    hover_fun(hit);
+  }
 
-    }, GetID().c_str(),
-       cur_category.c_str(),
-       margins.top,
-       margins.right,
-       margins.bottom,
-       margins.left
-    );
+  /// Internal function called (from JS) when the visualization is clicked.
+  void PointerClicked(double x, double y) {
+    if (click_fun) click_fun(QueryAt(x, y));
   }
 
 public:
@@ -332,7 +1207,16 @@ public:
     : D3Visualization(_width, _height), margins(), dynamic_width(_dynamic_width),
       data_drawn(false), data_loaded(false),
       state_seq_cname(), state_starts_cname(), state_durations_cname(), category_cname(),
-      seqID_cname(), seq_delim(), categories(), cur_category(""),
+      seqID_cname(), seq_delim(),
+      source(std::make_shared<Source>()), source_listener(0), source_loader(false), csv_stream(), streaming_load(false), stream_chunk_size(1 << 20),
+      render_cache_budget(250000), lod_mode(LODMode::AUTO), lod_bin_size(1.0), lod_active(false), lod(),
+      zoomed(false), zooming(false), viewport(), view_states(), view_positions(),
+      hover_fun(), click_fun(), hover_hit(),
+      render_backend(RenderBackend::SVG), canvas_rects(), canvas_groups(), profiler(),
+      sequence_order(SequenceOrder::FILE), ordering(),
+      show_frequency(false), frequency_width(150.0), frequency(), statistics(),
+      csv_filename(), append_error(), pending_extended(),
+      categories(), cur_category(""),
       actual_width(_width), actual_height(_height)
   {
     EM_ASM_ARGS({
@@ -343,24 +1227,396 @@ public:
       // Get a convenient handle on the object container.
       var vis = emp.StateSeqVis[obj_id];
       // Initialize some relevant objects.
-      vis["data"] = {};
-      vis["categories"] = [];
-      vis["seqs_by_category"] = {};
-      vis["domains"] = {};
-    }, GetID().c_str());
+      // Columns, categories and domains of our source (shared with every other view of it; see
+      // AttachSource).
+      vis["data"] = ({"num_states": 0, "num_seqs": 0, "state_names": [], "seq_id_names": [],
+                      "category_seqs": [], "category_counts": [], "categories": [], "domains": {}});
+      // Detached per-category subtrees, kept around for quick category switches.
+      vis["render_cache"] = ({"entries": {}, "elements": 0, "budget": $1, "tick": 0});
+      vis["active"] = null;
+      // Uncached layers: the level-of-detail summary and the culled (zoomed) view.
+      vis["lod"] = null;
+      vis["view"] = null;
+      vis["margins"] = ({top: $2, right: $3, bottom: $4, left: $5});
+      vis["sequence_width"] = $6;
+      // Canvas backend: the <canvas> element (created in Setup) and the CSS fill resolved per state.
+      vis["backend"] = "svg";
+      vis["canvas"] = null;
+      vis["state_colors"] = {};
+      // Zoom/pan: the behavior's transform is applied to the view it was last reset to ("base").
+      vis["zoom"] = ({"behavior": null, "base": null, "width": 0, "height": 0,
+                      "pending": null, "scheduled": false});
+      // Per-phase stats by phase name (filled in only when built with STATE_SEQ_VIS_PROFILE).
+      vis["stats"] = {};
+      // Statistics of one category (see ExportStatistics), for overlays and panels drawn from JS.
+      vis["statistics"] = null;
+      vis["GetStatistics"] = function(category) {
+        emp[obj_id+"_export_statistics"](category);
+        return vis["statistics"];
+      };
+
+      // Number of sequences loaded so far in category.
+      vis["CategorySize"] = function(category) {
+        var data = vis["data"];
+        return data["category_counts"][data["categories"].indexOf(category)] || 0;
+      };
+
+      // Indices of the sequences in category, from position first onward (as a plain array).
+      vis["CategorySequences"] = function(category, first) {
+        var data = vis["data"];
+        var c = data["categories"].indexOf(category);
+        if (!data["category_seqs"][c]) return [];
+        return Array.prototype.slice.call(data["category_seqs"][c].subarray(first, data["category_counts"][c]));
+      };
+
+      // Record/compare the layout a render cache entry was last positioned with.
+      vis["SetLayout"] = function(entry, x_domain, y_domain, width, height) {
+        entry["layout"] = [x_domain[0], x_domain[1], y_domain[0], y_domain[1], width, height];
+      };
+      vis["LayoutMatches"] = function(entry, x_domain, y_domain, width, height) {
+        var layout = entry["layout"];
+        return layout != null && layout[0] == x_domain[0] && layout[1] == x_domain[1] &&
+               layout[2] == y_domain[0] && layout[3] == y_domain[1] && layout[4] == width && layout[5] == height;
+      };
+
+      // Frame-coalesced resizing: any number of requests within a frame result in one layout.
+      vis["layout_pending"] = false;
+      vis["RequestLayout"] = function() {
+        if (vis["layout_pending"]) return;
+        vis["layout_pending"] = true;
+        window.requestAnimationFrame(function() {
+          vis["layout_pending"] = false;
+          emp[obj_id+"_resize"]();
+        });
+      };
+
+      // Size the svg, position the canvas, and (re-)render the axes and clip region for a view of
+      // x_domain by y_domain. Returns the canvas size as [width, height].
+      vis["LayoutFrame"] = function(x_domain, y_domain) {
+        var margins = vis["margins"];
+        var vis_width = emp[obj_id+"_get_width"]();
+        var vis_height = emp[obj_id+"_get_height"]();
+        var width = vis_width - margins.left - margins.right;
+        var height = vis_height - margins.top - margins.bottom;
+        d3.select("#"+obj_id).attr({"width": vis_width, "height": vis_height});
+        var canvas = d3.select("#StateSequenceVisualization-canvas-" + obj_id);
+        canvas.attr({"transform": "translate(" + margins.left + "," + margins.top + ")"});
+        d3.select("#StateSequenceVisualization-clip_rect-" + obj_id).attr({"width": width, "height": height});
+        var holder = d3.select("#StateSequenceVisualization-canvas2d_holder-" + obj_id);
+        if (vis["backend"] == "canvas" && vis["canvas"]) {
+          // Backing store at device resolution (this also clears it).
+          var ratio = window.devicePixelRatio || 1;
+          holder.attr({"width": width, "height": height}).style("display", null);
+          vis["canvas"].width = Math.max(1, Math.round(width * ratio));
+          vis["canvas"].height = Math.max(1, Math.round(height * ratio));
+          vis["canvas"].style.width = width + "px";
+          vis["canvas"].style.height = height + "px";
+        } else {
+          holder.style("display", "none");
+        }
+
+        var xScale = d3.scale.linear().domain(x_domain).range([0, width]);
+        var yScale = d3.scale.linear().domain(y_domain).range([0, height]);
+        canvas.selectAll(".y_axis").remove();
+        canvas.selectAll(".x_axis").remove();
+        var xAxis = d3.svg.axis().scale(xScale).tickValues([]).orient("top");
+        var yAxis = d3.svg.axis().scale(yScale).orient("left");
+        canvas.append("g").attr({"class": "axis y_axis",
+                                 "id": "StateSequenceVisualization-y_axis-" + obj_id
+                               }).call(yAxis);
+        canvas.append("g").attr({"class": "axis x_axis",
+                                 "id": "StateSequenceVisualization-x_axis-" + obj_id
+                                }).call(xAxis);
+        var axes = canvas.selectAll(".axis");
+        axes.selectAll("path").style({"fill": "none", "stroke": "black", "shape-rendering": "crispEdges"});
+        axes.selectAll("text").style({"font-family": "sans-serif", "font-size": "10px"});
+        return [width, height];
+      };
+
+      // Get (creating it if needed) one of the uncached layers ("lod" or "view") under the data canvas.
+      vis["Layer"] = function(name) {
+        if (!vis[name]) {
+          var data_canvas = d3.select("#StateSequenceVisualization-data_canvas-" + obj_id);
+          vis[name] = ({"layout": null,
+                        "group": data_canvas.append("g").attr({"class": "StateSequenceVisualization-" + name})});
+        }
+        return vis[name];
+      };
+      vis["ClearLayer"] = function(name) {
+        if (vis[name]) vis[name]["group"].selectAll("*").remove();
+      };
+
+      // Fill color that CSS gives the rects of state name (falls back to the default grey).
+      // Resolved once per state with a hidden probe rect inside the data canvas.
+      vis["StateColor"] = function(name) {
+        var colors = vis["state_colors"];
+        if (colors.hasOwnProperty(name)) return colors[name];
+        var probe = d3.select("#StateSequenceVisualization-probe-" + obj_id);
+        if (probe.empty()) {
+          probe = d3.select("#StateSequenceVisualization-data_canvas-" + obj_id).append("g")
+            .attr({"class": "StateSequenceVisualization-category", "visibility": "hidden"})
+            .append("rect").attr({"id": "StateSequenceVisualization-probe-" + obj_id, "fill": "grey",
+                                  "width": 0, "height": 0});
+        }
+        probe.attr({"class": name});
+        var fill = window.getComputedStyle(probe.node()).fill;
+        colors[name] = (fill && fill != "none") ? fill : "grey";
+        return colors[name];
+      };
+
+      // Paint num_groups groups of rects onto the canvas for a view of x_domain by y_domain.
+      // rects indexes HEAPF64 (x, y, width, height in data units, grouped by state) and groups indexes
+      // HEAP32 (state, first rect, rect count). Each group is one path and one fill; outline adds the
+      // same hairline white border the SVG backend draws.
+      vis["PaintCanvas"] = function(x_domain, y_domain, rects, groups, num_groups, outline) {
+        var size = vis["LayoutFrame"](x_domain, y_domain);
+        vis["DeactivateCategory"]();
+        vis["EvictRenderCache"]();
+        vis["ClearLayer"]("lod");
+        vis["ClearLayer"]("view");
+        if (!vis["canvas"]) return;
+        var ctx = vis["canvas"].getContext("2d");
+        var ratio = window.devicePixelRatio || 1;
+        var sx = ratio * size[0] / ((x_domain[1] - x_domain[0]) || 1);
+        var sy = ratio * size[1] / ((y_domain[1] - y_domain[0]) || 1);
+        var state_names = vis["data"]["state_names"];
+        ctx.lineWidth = 0.5;
+        ctx.strokeStyle = "white";
+        for (var g = 0; g < num_groups; g++) {
+          var state = HEAP32[groups + 3 * g];
+          var first = HEAP32[groups + 3 * g + 1];
+          var end = first + HEAP32[groups + 3 * g + 2];
+          // Path coordinates are transformed as they are added: build the path in data units...
+          ctx.setTransform(sx, 0, 0, sy, -sx * x_domain[0], -sy * y_domain[0]);
+          ctx.beginPath();
+          for (var r = first; r < end; r++) {
+            var i = rects + 4 * r;
+            ctx.rect(HEAPF64[i], HEAPF64[i + 1], HEAPF64[i + 2], HEAPF64[i + 3]);
+          }
+          ctx.fillStyle = vis["StateColor"](state_names[state]);
+          ctx.fill();
+          // ...but stroke with a pixel-space line width.
+          if (outline) {
+            ctx.setTransform(ratio, 0, 0, ratio, 0, 0);
+            ctx.stroke();
+          }
+        }
+      };
+
+      // Re-base the zoom behavior on view ([x_min, x_max, y_min, y_max]) with an identity transform.
+      vis["ResetZoom"] = function(view) {
+        var zoom = vis["zoom"];
+        var margins = vis["margins"];
+        zoom["base"] = view;
+        zoom["width"] = emp[obj_id+"_get_width"]() - margins.left - margins.right;
+        zoom["height"] = emp[obj_id+"_get_height"]() - margins.top - margins.bottom;
+        if (zoom["behavior"]) zoom["behavior"].scale(1).translate([0, 0]);
+      };
+
+      // Attach zoom/pan handling to svg. Zoom events only record the requested view; it is applied at
+      // most once per animation frame.
+      vis["AttachZoom"] = function(svg) {
+        vis["zoom"]["behavior"] = d3.behavior.zoom().on("zoom", function() {
+          var zoom = vis["zoom"];
+          var base = zoom["base"];
+          if (!base || zoom["width"] <= 0 || zoom["height"] <= 0) return;
+          var margins = vis["margins"];
+          var k = d3.event.scale;
+          var t = d3.event.translate;
+          // Map canvas positions back through the (svg space) zoom transform to the base view.
+          var ToX = function(px) {
+            return base[0] + ((px + margins.left - t[0]) / k - margins.left) / zoom["width"] * (base[1] - base[0]);
+          };
+          var ToY = function(py) {
+            return base[2] + ((py + margins.top - t[1]) / k - margins.top) / zoom["height"] * (base[3] - base[2]);
+          };
+          zoom["pending"] = [ToX(0), ToX(zoom["width"]), ToY(0), ToY(zoom["height"])];
+          if (zoom["scheduled"]) return;
+          zoom["scheduled"] = true;
+          window.requestAnimationFrame(function() {
+            zoom["scheduled"] = false;
+            var view = zoom["pending"];
+            emp[obj_id+"_zoom_to"](view[0], view[1], view[2], view[3]);
+          });
+        });
+        svg.call(vis["zoom"]["behavior"]);
+      };
+
+      // Attach hover/click handling to svg: one set of handlers for everything drawn (which carries no
+      // data of its own; queries go through QueryAt). Moves are handled at most once per animation frame.
+      vis["pointer"] = ({"pending": null, "scheduled": false});
+      vis["AttachPointer"] = function(svg) {
+        var pointer = vis["pointer"];
+        var Move = function(position) {
+          pointer["pending"] = position;
+          if (pointer["scheduled"]) return;
+          pointer["scheduled"] = true;
+          window.requestAnimationFrame(function() {
+            pointer["scheduled"] = false;
+            emp[obj_id+"_pointer_moved"](pointer["pending"][0], pointer["pending"][1]);
+          });
+        };
+        svg.on("mousemove.pointer", function() { Move(d3.mouse(this)); })
+           .on("mouseleave.pointer", function() { Move([-1, -1]); })
+           .on("click.pointer", function() {
+             var position = d3.mouse(this);
+             emp[obj_id+"_pointer_clicked"](position[0], position[1]);
+           });
+      };
+
+      // Map a render cache entry's subtree (drawn in data units) onto a width x height canvas
+      // showing x_domain/y_domain: a single group transform, whatever the number of elements.
+      vis["PositionGroup"] = function(entry, x_domain, y_domain, width, height) {
+        var x_extent = (x_domain[1] - x_domain[0]) || 1;
+        var y_extent = (y_domain[1] - y_domain[0]) || 1;
+        entry["group"].attr({"transform": "scale(" + (width / x_extent) + "," + (height / y_extent) + ")" +
+                                          " translate(" + (-x_domain[0]) + "," + (-y_domain[0]) + ")"});
+        vis["SetLayout"](entry, x_domain, y_domain, width, height);
+      };
+
+      // Drop least-recently-used detached subtrees until the cache fits in its budget.
+      vis["EvictRenderCache"] = function() {
+        var cache = vis["render_cache"];
+        while (cache["elements"] > cache["budget"]) {
+          var lru = null;
+          for (var category in cache["entries"]) {
+            var candidate = cache["entries"][category];
+            if (candidate !== vis["active"] && (lru == null || candidate["last_used"] < lru["last_used"])) {
+              lru = candidate;
+            }
+          }
+          if (lru == null) break;
+          delete cache["entries"][lru["category"]];
+          cache["elements"] -= lru["elements"];
+        }
+      };
+
+      // Detach the active subtree (if any) into the cache. (Call EvictRenderCache afterwards.)
+      vis["DeactivateCategory"] = function() {
+        var active = vis["active"];
+        if (!active) return;
+        var node = active["group"].node();
+        node.parentNode.removeChild(node);
+        vis["render_cache"]["elements"] += active["elements"];
+        vis["active"] = null;
+      };
+
+      // Make category's subtree the one attached under data_canvas, detaching the current one into
+      // the cache. Returns the (possibly new and still empty) render cache entry for category.
+      vis["ActivateCategory"] = function(data_canvas, category) {
+        var cache = vis["render_cache"];
+        var active = vis["active"];
+        if (active && active["category"] == category) {
+          active["last_used"] = ++cache["tick"];
+          return active;
+        }
+        vis["DeactivateCategory"]();
+        var entry = cache["entries"][category];
+        if (entry) {
+          data_canvas.node().appendChild(entry["group"].node());
+          cache["elements"] -= entry["elements"];
+        } else {
+          // The white, non-scaling outline separates neighboring states at any zoom level.
+          entry = ({"category": category, "drawn_count": -1, "elements": 0, "layout": null, "nodes": {},
+                    "group": data_canvas.append("g").attr({"class": "StateSequenceVisualization-category",
+                                                           "stroke": "white", "stroke-width": 0.5})});
+          cache["entries"][category] = entry;
+        }
+        entry["last_used"] = ++cache["tick"];
+        vis["active"] = entry;
+        vis["EvictRenderCache"]();
+        return entry;
+      };
+
+      // Give rects (bound to state indices) their state's class and time span.
+      vis["SetStateAttributes"] = function(rects) {
+        var data = vis["data"];
+        rects.attr({"class": function(k) { return data["state_names"][data["states"][k]]; },
+                    "y": function(k) { return data["starts"][k]; },
+                    "height": function(k) { return data["durations"][k]; },
+                    "width": vis["sequence_width"],
+                    "fill": "grey",
+                    "vector-effect": "non-scaling-stroke"
+                  });
+      };
+
+      // Append one <g> (with one <rect> per state) to entry's group for each sequence index in seqs.
+      // Elements are placed in data units (x = sequence position, y = time); PositionGroup scales
+      // them onto the canvas. The first new sequence is drawn at x position first_index.
+      // Returns the number of elements added.
+      vis["AppendSequences"] = function(entry, seqs, first_index) {
+        var data = vis["data"];
+        var num_elements = seqs.length;
+        var sequences = entry["group"].selectAll(".state-sequence-entering").data(seqs).enter().append("g");
+        sequences.attr({"class": "state-sequence-" + obj_id,
+                        "id": function(seq) { return data["seq_id_names"][data["seq_ids"][seq]] + "_" + obj_id; },
+                        "transform": function(seq, i) { return "translate(" + (first_index + i) + ",0)"; }
+                      });
+
+        sequences.each(function(seq, i) {
+          entry["nodes"][seq] = this;
+          var begin = data["seq_begins"][seq];
+          num_elements += data["seq_lengths"][seq];
+          var states = d3.select(this).selectAll("rect").data(d3.range(begin, begin + data["seq_lengths"][seq]));
+          states.enter().append("rect");
+          vis["SetStateAttributes"](states);
+        });
+        return num_elements;
+      };
+
+      // Append the states added to each (extended) sequence in seqs to the subtree showing it, if
+      // there is one; the rects already there are left alone (they are in the sequence's order).
+      vis["ExtendSequences"] = function(seqs) {
+        var data = vis["data"];
+        var cache = vis["render_cache"];
+        for (var i = 0; i < seqs.length; i++) {
+          var seq = seqs[i];
+          var entry = cache["entries"][data["categories"][data["seq_categories"][seq]]];
+          var node = entry ? entry["nodes"][seq] : null;
+          if (!node) continue;
+          var drawn = node.childElementCount;
+          var added = data["seq_lengths"][seq] - drawn;
+          if (added <= 0) continue;
+          var begin = data["seq_begins"][seq] + drawn;
+          vis["SetStateAttributes"](d3.select(node).selectAll(".state-entering")
+                                      .data(d3.range(begin, begin + added)).enter().append("rect"));
+          entry["elements"] += added;
+          if (entry !== vis["active"]) cache["elements"] += added;
+        }
+        vis["EvictRenderCache"]();
+      };
+    }, GetID().c_str(), render_cache_budget, margins.top, margins.right, margins.bottom, margins.left,
+       (double) StateSequenceLayout::SEQUENCE_WIDTH);
   }
 
+  ~StateSequenceVisualization() { ReleaseSource(); }
+
   /// Setup is called automatically when the emp::Document is ready.
   void Setup() {
-    JSWrap([this]() { this->DataCallback(); }, GetID() + "_data_callback");
+    JSWrap([this](uint32_t buffer, uint32_t size, double fetch_time) { this->LoadCSVBuffer(buffer, size, fetch_time); },
+           GetID() + "_load_csv_buffer");
+    JSWrap([this](uint32_t buffer, uint32_t size, double fetch_time) { this->LoadBinaryBuffer(buffer, size, fetch_time); },
+           GetID() + "_load_binary_buffer");
+    JSWrap([this](uint32_t buffer, uint32_t size) { return this->FeedCSVChunk(buffer, size); }, GetID() + "_feed_csv_chunk");
+    JSWrap([this](double fetch_time) { this->FinishCSV(fetch_time); }, GetID() + "_finish_csv");
+    JSWrap([this](uint32_t buffer, uint32_t size) { return this->AppendCSVData(reinterpret_cast<const char *>(buffer), size, true); },
+           GetID() + "_append_csv_file_data");
+    JSWrap([this]() { return (double) this->source->file_offset; }, GetID() + "_get_file_offset");
+    JSWrap([this](std::string error) { this->SourceFailed(error); }, GetID() + "_source_failed");
+    JSWrap([this]() { this->DrawNewSequences(); }, GetID() + "_draw_new_sequences");
     JSWrap([this](double w) { this->SetWidthInternal(w); }, GetID() + "_set_width");
     JSWrap([this](double h) { this->SetHeightInternal(h); }, GetID() + "_set_height");
     JSWrap([this]() { return this->GetForRealWidth(); }, GetID() + "_get_width");
     JSWrap([this]() { return this->GetForRealHeight(); }, GetID() + "_get_height");
     JSWrap([this]() { return this->IsDynamicWidth(); }, GetID() + "_is_dynamic_width");
     JSWrap([this]() { this->Resize(); }, GetID() + "_resize");
+    JSWrap([this](double x_min, double x_max, double y_min, double y_max) { this->ZoomTo(x_min, x_max, y_min, y_max); },
+           GetID() + "_zoom_to");
     JSWrap([this](std::string cat) { this->SetCurrentCategoryInternal(cat); }, GetID() + "_set_current_category");
     JSWrap([this]() { this->Redraw(); }, GetID() + "_redraw");
+    JSWrap([this](double x, double y) { this->PointerMoved(x, y); }, GetID() + "_pointer_moved");
+    JSWrap([this](double x, double y) { this->PointerClicked(x, y); }, GetID() + "_pointer_clicked");
+    JSWrap([this](std::string cat) { this->ExportStatistics(cat); }, GetID() + "_export_statistics");
     EM_ASM_ARGS({
       var vis_obj_id = Pointer_stringify($0);
       var GetHeight = emp[vis_obj_id+"_get_height"];
@@ -368,7 +1624,7 @@ public:
       var SetHeight = emp[vis_obj_id+"_set_height"];
       var SetWidth = emp[vis_obj_id+"_set_width"];
       var IsDynamicWidth = emp[vis_obj_id+"_is_dynamic_width"];
-      var Resize = emp[vis_obj_id+"_resize"];
+      var vis = emp.StateSeqVis[vis_obj_id];
       // Setup canvasi.
       var svg = d3.select("#"+vis_obj_id);
       // Set size. (dynamic sizing vs. static)
@@ -381,13 +1637,29 @@ public:
       svg.selectAll("*").remove();
       var canvas = svg.append("g").attr({"id": "StateSequenceVisualization-canvas-" + vis_obj_id,
                                          "class": "StateSequenceVisualization-canvas"});
+      // Sequences are clipped to the canvas (partially visible states when zoomed in).
+      svg.append("defs").append("clipPath").attr({"id": "StateSequenceVisualization-clip-" + vis_obj_id})
+        .append("rect").attr({"id": "StateSequenceVisualization-clip_rect-" + vis_obj_id});
       var data_canvas = canvas.append("g").attr({"id": "StateSequenceVisualization-data_canvas-" + vis_obj_id,
-                                                 "class": "StateSequenceVisualization-data_canvas"});
+                                                 "class": "StateSequenceVisualization-data_canvas",
+                                                 "clip-path": "url(#StateSequenceVisualization-clip-" + vis_obj_id + ")"});
+      // Canvas backend target: a <canvas> over the data area (below the axes), sized by LayoutFrame.
+      var holder = canvas.append("foreignObject").attr({"id": "StateSequenceVisualization-canvas2d_holder-" + vis_obj_id,
+                                                        "x": 0, "y": 0, "width": 0, "height": 0})
+                         .style({"display": "none", "pointer-events": "none"});
+      vis["canvas"] = document.createElementNS("http://www.w3.org/1999/xhtml", "canvas");
+      vis["canvas"].style.display = "block";
+      holder.node().appendChild(vis["canvas"]);
+      // State-frequency panel (right of the data area; see SetFrequencyPanel).
+      svg.append("g").attr({"id": "StateSequenceVisualization-frequency-" + vis_obj_id,
+                            "class": "StateSequenceVisualization-frequency"}).style("display", "none");
+      vis["AttachZoom"](svg);
+      vis["AttachPointer"](svg);
       // Add a window resize event listener.
       window.addEventListener("resize", function() {
                                           if (IsDynamicWidth()) {
                                             SetWidth(svg[0][0].parentNode.clientWidth);
-                                            Resize();
+                                            vis["RequestLayout"]();
                                           }
                                         }
                               );
@@ -396,6 +1668,13 @@ public:
     this->pending_funcs.Run();
   }
 
+  /// Get the natively parsed dataset backing this visualization. (Visualizations that load the
+  /// same file with the same schema share one dataset; see StateSequenceDatasetStore.)
+  const StateSequenceDataset & GetDataset() const { return source->dataset; }
+
+  /// How many visualizations (including this one) share this visualization's dataset?
+  size_t GetDatasetUseCount() const { return (size_t) source.use_count(); }
+
   /// Get the current set of available categories that can be displayed.
   const emp::vector<std::string> & GetCategories() const { return categories; }
 
@@ -420,41 +1699,236 @@ public:
   /// Set visualization width.
   /// Warning: if you set the visualization width, it will automatically change this visualization
   /// to non-dynamically sizing.
-  /// Once width is updated, resizes the visualization.
+  /// Once width is updated, resizes the visualization (on the next animation frame).
   void SetWidth(double w) {
     dynamic_width = false;
     SetWidthInternal(w);
-    if (data_drawn) Resize();
+    if (data_drawn) ScheduleResize();
   }
 
   /// Set visualization height.
-  /// Once the height is set, resizes the visualization.
+  /// Once the height is set, resizes the visualization (on the next animation frame).
   void SetHeight(double h) {
     SetHeightInternal(h);
-    if (data_drawn) Resize();
+    if (data_drawn) ScheduleResize();
   }
 
   /// Set visualization width/height in one go.
   /// Warning: if you set the visualization width/height this way, it will automatically change this visualization
   /// to non-dynamically sizing.
-  /// Once values are set, resize visualization.
+  /// Once values are set, resize visualization (on the next animation frame).
   void SetSize(double w, double h) {
     dynamic_width = false;
     SetWidthInternal(w);
     SetHeightInternal(h);
-    if (data_drawn) Resize();
+    if (data_drawn) ScheduleResize();
+  }
+
+  /// Should CSV data be loaded progressively? When enabled, the file is parsed in chunks of at most
+  /// chunk_size bytes as it downloads; the first sequences are drawn as soon as they arrive and
+  /// later ones are appended to the view in batches (at most once per animation frame).
+  void SetStreamingLoad(bool val, size_t chunk_size=(1 << 20)) {
+    streaming_load = val;
+    stream_chunk_size = chunk_size;
+  }
+
+  /// Is progressive (streaming) CSV loading enabled?
+  bool IsStreamingLoad() const { return streaming_load; }
+
+  /// Set the render cache budget: the maximum number of SVG elements kept in detached subtrees of
+  /// previously displayed categories. Switching back to a cached category re-attaches its subtree
+  /// instead of rebuilding it. Least-recently-used subtrees are dropped to stay within budget.
+  void SetRenderCacheBudget(size_t max_elements) {
+    render_cache_budget = max_elements;
+    EM_ASM_ARGS({
+      var vis = emp.StateSeqVis[Pointer_stringify($0)];
+      vis["render_cache"]["budget"] = $1;
+      vis["EvictRenderCache"]();
+    }, GetID().c_str(), max_elements);
+  }
+
+  /// Get the render cache budget (in SVG elements).
+  size_t GetRenderCacheBudget() const { return render_cache_budget; }
+
+  /// Set when to draw a level-of-detail summary instead of every state (see LODMode), and the size
+  /// (in pixels) of the summary's bins. Redraws if data has already been drawn.
+  void SetLODMode(LODMode mode, double bin_size=1.0) {
+    emp_assert(bin_size > 0.0, bin_size);
+    lod_mode = mode;
+    lod_bin_size = bin_size;
+    if (data_drawn) Draw();
+  }
+
+  /// Choose how sequences are drawn (see RenderBackend). Redraws if data has already been drawn.
+  void SetRenderBackend(RenderBackend backend) {
+    render_backend = backend;
+    EM_ASM_ARGS({
+      emp.StateSeqVis[Pointer_stringify($0)]["backend"] = $1 ? "canvas" : "svg";
+    }, GetID().c_str(), backend == RenderBackend::CANVAS);
+    if (data_drawn) Draw();
+  }
+
+  /// Choose where sequences are placed along the x axis (see SequenceOrder); metric is the distance
+  /// used to cluster sequences for SIMILARITY. Orders are computed once per category (and again as
+  /// a streaming load adds sequences to it). Categories too large for the ordering's distance budget
+  /// (see StateSequenceOrdering::SetMaxPairs) are ordered by clustering a sample of them, so the
+  /// matrix always fits in the heap. Reordered views are drawn like zoomed ones: without the
+  /// per-category subtree cache. Redraws if data has already been drawn.
+  void SetSequenceOrder(SequenceOrder order,
+                        StateSequenceOrdering::Metric metric=StateSequenceOrdering::Metric::EDIT) {
+    sequence_order = order;
+    ordering.SetMetric(metric);
+    if (data_drawn) Draw();
+  }
+
+  /// Get where sequences are placed along the x axis.
+  SequenceOrder GetSequenceOrder() const { return sequence_order; }
+
+  /// Get the distance used for similarity ordering.
+  StateSequenceOrdering::Metric GetSequenceOrderMetric() const { return ordering.GetMetric(); }
+
+  /// Show (or hide) a state-frequency panel of the given width (in pixels) to the right of the data
+  /// area: a stacked area chart of the fraction of the current category's sequences in each state
+  /// over the time span in view (sharing the data area's time axis). Frequencies are computed with
+  /// one sweep over each category's sorted state boundaries, which are cached per category.
+  /// The panel is laid out as part of the right margin. Redraws if data has already been drawn.
+  void SetFrequencyPanel(bool show, double width=150.0) {
+    emp_assert(width > 0.0, width);
+    const double old_space = show_frequency ? frequency_width + FREQUENCY_GAP : 0.0;
+    show_frequency = show;
+    frequency_width = width;
+    margins.right += (show ? frequency_width + FREQUENCY_GAP : 0.0) - old_space;
+    EM_ASM_ARGS({ emp.StateSeqVis[Pointer_stringify($0)]["margins"].right = $1; }, GetID().c_str(), margins.right);
+    if (data_drawn) Draw();
+  }
+
+  /// Is the state-frequency panel shown?
+  bool IsFrequencyPanelShown() const { return show_frequency; }
+
+  /// Get the state frequencies most recently drawn in the panel.
+  const StateSequenceFrequency & GetFrequency() const { return frequency; }
+
+  /// Get the transition counts, stays and occupancy (total time) per state of category (see
+  /// StateSequenceStatistics), computed on first use and cached until the category changes.
+  /// From JS: emp.StateSeqVis[id]["GetStatistics"](category) gives the same as typed arrays, along
+  /// with mean dwell times.
+  const StateSequenceStatistics::Summary & GetStatistics(const std::string & category) {
+    const auto cat = source->dataset.GetCategoryCode(category);
+    emp_assert(cat != -1, category);
+    return statistics.Get(source->dataset, cat);
+  }
+
+  /// Find what is drawn at point (x, y) of the visualization (in pixels, relative to its top left
+  /// corner, as given by mouse events): the point is mapped through the current view to a sequence
+  /// position and a time, and the state in effect then is found with a binary search over that
+  /// sequence's starts. Cost does not depend on how much is drawn.
+  Hit QueryAt(double x, double y) const {
+    Hit hit;
+    if (!data_drawn) return hit;
+    const StateSequenceLayout layout = GetLayout();
+    x -= margins.left;
+    y -= margins.top;
+    if (!(x >= 0.0 && x < layout.GetCanvasWidth() && y >= 0.0 && y < layout.GetCanvasHeight())) return hit;
+    const double pos = layout.Position(x);
+    const auto & seqs = GetDisplaySequences();
+    hit.time = layout.Time(y);
+    if (!(pos >= 0.0 && pos < (double) seqs.size())) return hit;
+    hit.position = (size_t) pos;
+    // Between sequences?
+    if (pos - (double) hit.position > StateSequenceLayout::SEQUENCE_WIDTH) return hit;
+    hit.sequence = seqs[hit.position];
+    const size_t state = source->interval_index.FindStateAt(source->dataset, hit.sequence, hit.time);
+    if (state == StateSequenceIntervalIndex::NO_STATE) return hit;
+    hit.state = (StateSequenceDataset::index_t) state;
+    hit.found = true;
+    return hit;
   }
 
-  /// Set current category to display.
+  /// Find every state drawn (at least partly) inside the rectangle with corners (x0, y0) and (x1, y1)
+  /// (in pixels, as for QueryAt; clipped to the data area). Fills states with their indices and
+  /// positions with the sequence position each is drawn at.
+  void QueryRange(double x0, double y0, double x1, double y1,
+                  emp::vector<StateSequenceDataset::index_t> & states,
+                  emp::vector<StateSequenceDataset::index_t> & positions) const {
+    states.clear();
+    positions.clear();
+    if (!data_drawn) return;
+    const StateSequenceLayout layout = GetLayout();
+    const double width = layout.GetCanvasWidth();
+    const double height = layout.GetCanvasHeight();
+    if (!(width > 0.0 && height > 0.0)) return;
+    x0 = std::min(std::max(x0 - margins.left, 0.0), width);
+    x1 = std::min(std::max(x1 - margins.left, 0.0), width);
+    y0 = std::min(std::max(y0 - margins.top, 0.0), height);
+    y1 = std::min(std::max(y1 - margins.top, 0.0), height);
+    StateSequenceDataset::Domain range(layout.Position(std::min(x0, x1)), layout.Position(std::max(x0, x1)),
+                                       layout.Time(std::min(y0, y1)), layout.Time(std::max(y0, y1)));
+    // A range starting between sequences starts with the next one.
+    const double first = std::floor(range.x_min);
+    if (range.x_min - first > StateSequenceLayout::SEQUENCE_WIDTH) range.x_min = first + 1.0;
+    if (range.x_min > range.x_max) return;
+    CollectStates(range, states, positions);
+  }
+
+  /// Call fun with the state under the mouse (see QueryAt) whenever it changes; hits that are not
+  /// found mean the mouse has left every state. (One handler serves the whole visualization.)
+  void SetHoverCallback(const hit_fun_t & fun) {
+    hover_fun = fun;
+    hover_hit = Hit();
+  }
+
+  /// Call fun with what is under the mouse (see QueryAt) whenever the visualization is clicked.
+  void SetClickCallback(const hit_fun_t & fun) { click_fun = fun; }
+
+  /// Get the current render backend.
+  RenderBackend GetRenderBackend() const { return render_backend; }
+
+  /// Get the current level-of-detail mode.
+  LODMode GetLODMode() const { return lod_mode; }
+
+  /// Is the level-of-detail summary what's currently displayed?
+  bool IsLODActive() const { return lod_active; }
+
+  /// Get the most recently built level-of-detail summary.
+  const StateSequenceLOD & GetLOD() const { return lod; }
+
+  /// Show only part of the current category: sequence positions [x_min, x_max] (the sequence at
+  /// position p occupies [p, p + 0.9]) and times [y_min, y_max]. Only the states overlapping the
+  /// viewport are drawn. The viewport is fit into the category's domain when drawn.
+  /// (Zooming/panning with the mouse sets the viewport too.)
+  void SetViewport(double x_min, double x_max, double y_min, double y_max) {
+    emp_assert(x_min < x_max && y_min < y_max, x_min, x_max, y_min, y_max);
+    viewport = StateSequenceDataset::Domain(x_min, x_max, y_min, y_max);
+    zoomed = true;
+    if (data_drawn) Draw();
+  }
+
+  /// Go back to showing the whole current category.
+  void ResetViewport() {
+    zoomed = false;
+    if (data_drawn) Draw();
+  }
+
+  /// Is a viewport (rather than the whole category) being shown?
+  bool IsZoomed() const { return zoomed; }
+
+  /// Get the region currently in view (x = sequence positions, y = time).
+  StateSequenceDataset::Domain GetViewport() const {
+    if (!data_loaded || source->dataset.GetCategoryCode(cur_category) == -1) return viewport;
+    return GetViewDomain();
+  }
+
+  /// Set current category to display (showing all of it; any viewport is reset).
   /// If data has already been loaded, redraw.
   /// Warning: does not check validity of category here. Validity is checked during drawing.
   void SetCurrentCategory(const std::string & cat) {
+    zoomed = false;
     SetCurrentCategoryInternal(cat);
     if (data_loaded) Draw();
   }
 
   /// Load data from file given:
-  ///   * filename: name/path to data file (expects .csv)
+  ///   * filename: name/path to data file (expects .csv; gzip-compressed files also work, see StateSequenceDecompressor)
   ///   * states: name of the column that gives state sequence.
   ///   * starts: name of the column that gives the start points for each state in the state sequence.
   ///   * durations: name of the column that gives the durations for each state in the state sequence.
@@ -482,6 +1956,115 @@ public:
     }
   }
 
+  /// Load data from a binary file written by StateSequenceBinary (see examples/state_sequence_convert).
+  /// Domains, categories and columns are read directly from the file; no text parsing happens.
+  void LoadDataFromBinary(std::string filename) {
+    data_loaded = false;
+    data_drawn = false;
+
+    if (this->init) {
+      LoadDataFromBinaryInternal(filename);
+    } else {
+      this->pending_funcs.Add([this, filename]() { this->LoadDataFromBinaryInternal(filename); });
+    }
+  }
+
+  /// Live mode: append CSV records (in the loaded file's layout, without a header) to the data once it
+  /// has loaded; see FollowCSV to keep up with a file as it grows. Records for a sequence ID already
+  /// in their category add states to the end of that sequence; others add new sequences. Domains are
+  /// updated incrementally and only the affected sequences are redrawn, so the cost of an append
+  /// follows the size of the new data. Every visualization sharing the data sees the change.
+  /// A record may be split across appends (but pushes mixed with FollowCSV should be whole records).
+  /// Returns false if the records could not be appended (see GetAppendError); a malformed record
+  /// stops all appending to this data.
+  bool AppendCSV(const std::string & text) { return AppendCSVData(text.data(), text.size(), false); }
+
+  /// Why the last append failed ("" if it did not).
+  const std::string & GetAppendError() const { return append_error; }
+
+  /// Live mode: check the loaded CSV file for new data every interval seconds, and append anything
+  /// written since (see AppendCSV), a whole line at a time. Only the new bytes are requested (with an HTTP
+  /// range request, if the server supports them); records pushed with AppendCSV do not move the offset
+  /// reading resumes at. Following stops on a failed append, on StopFollowing, or when this
+  /// visualization loads something else. Compressed files cannot be followed.
+  void FollowCSV(double interval=5.0) {
+    emp_assert(interval > 0.0, interval);
+    if (csv_filename.empty() || source->compressed) return;
+    EM_ASM_ARGS({
+      var vis_obj_id = Pointer_stringify($0);
+      var filename = Pointer_stringify($1);
+      var vis = emp.StateSeqVis[vis_obj_id];
+      var AppendCSVFileData = emp[vis_obj_id+"_append_csv_file_data"];
+      var GetFileOffset = emp[vis_obj_id+"_get_file_offset"];
+      var token = vis["load_token"];
+      var data = vis["data"];
+      // One follower per dataset (shared by every view of it), with one request in flight at a time.
+      if (data["follow"]) clearInterval(data["follow"]["timer"]);
+      var follow = data["follow"] = ({"timer": null, "busy": false});
+      var Stop = function() {
+        clearInterval(follow["timer"]);
+        if (data["follow"] === follow) data["follow"] = null;
+      };
+      var Poll = function() {
+        if (vis["load_token"] !== token || data["follow"] !== follow) {
+          Stop();
+          return;
+        }
+        if (follow["busy"]) return;
+        follow["busy"] = true;
+        var offset = GetFileOffset();
+        fetch(filename, ({"headers": ({"Range": "bytes=" + offset + "-"}), "cache": "no-store"})).then(function(response) {
+          // 416: nothing past offset yet.
+          if (response.status == 416) return null;
+          if (!response.ok) throw new Error(response.statusText);
+          return response.arrayBuffer().then(function(buffer) {
+            // Servers that ignore the range send the whole file.
+            return (response.status == 206) ? new Uint8Array(buffer)
+                                             : new Uint8Array(buffer, Math.min(offset, buffer.byteLength));
+          });
+        }).then(function(bytes) {
+          follow["busy"] = false;
+          if (!bytes || !bytes.length || vis["load_token"] !== token || data["follow"] !== follow) return;
+          // Only whole lines are taken (the rest is requested again next time), so records pushed
+          // with AppendCSV in between never land in the middle of one from the file.
+          var size = bytes.lastIndexOf(10) + 1;
+          if (size == 0) return;
+          var buffer = _malloc(size);
+          HEAPU8.set(bytes.subarray(0, size), buffer);
+          var ok = AppendCSVFileData(buffer, size);
+          _free(buffer);
+          if (!ok) Stop();
+        }).catch(function() { follow["busy"] = false; });
+      };
+      follow["timer"] = setInterval(Poll, $2 * 1000);
+    }, GetID().c_str(), csv_filename.c_str(), interval);
+  }
+
+  /// Stop following the loaded CSV file (see FollowCSV).
+  void StopFollowing() {
+    EM_ASM_ARGS({
+      var data = emp.StateSeqVis[Pointer_stringify($0)]["data"];
+      if (data["follow"]) clearInterval(data["follow"]["timer"]);
+      data["follow"] = null;
+    }, GetID().c_str());
+  }
+
+  /// Get per-phase load/draw/resize stats (see StateSequenceProfiler). Stats are only recorded when
+  /// built with STATE_SEQ_VIS_PROFILE; they are also available from JS as
+  /// emp.StateSeqVis[id]["stats"][phase name].
+  const StateSequenceProfiler & GetProfiler() const { return profiler; }
+
+  /// Get stats for one phase (see GetProfiler).
+  const StateSequenceProfiler::Stats & GetStats(StateSequenceProfiler::Phase phase) const {
+    return profiler.GetStats(phase);
+  }
+
+  /// Forget all recorded stats.
+  void ResetStats() {
+    profiler.Reset();
+    EM_ASM_ARGS({ emp.StateSeqVis[Pointer_stringify($0)]["stats"] = {}; }, GetID().c_str());
+  }
+
   /// Redraw the visualization. Does nothing if data has not been drawn yet.
   void Redraw() {
     if (!data_drawn) return;
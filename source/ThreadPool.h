@@ -0,0 +1,93 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+namespace emp {
+
+/// Fixed-size pool of worker threads for native (non-web) builds.
+class ThreadPool {
+protected:
+  emp::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable task_cv;   ///< Signaled when a task is queued (or the pool stops).
+  std::condition_variable idle_cv;   ///< Signaled when the last running task finishes.
+  size_t num_active;                 ///< Tasks queued or running.
+  bool stopping;
+
+  void WorkerLoop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        task_cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;
+        task = std::move(tasks.front());
+        tasks.pop();
+      }
+      task();
+      std::unique_lock<std::mutex> lock(mutex);
+      if (--num_active == 0) idle_cv.notify_all();
+    }
+  }
+
+public:
+  /// Create a pool with num_threads workers (0 = one per hardware thread).
+  ThreadPool(size_t num_threads=0)
+    : workers(), tasks(), mutex(), task_cv(), idle_cv(), num_active(0), stopping(false)
+  {
+    if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < num_threads; ++i) workers.emplace_back([this]() { WorkerLoop(); });
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool & operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    task_cv.notify_all();
+    for (auto & worker : workers) worker.join();
+  }
+
+  size_t GetNumThreads() const { return workers.size(); }
+
+  /// Queue task to run on a worker thread.
+  void Run(std::function<void()> task) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      emp_assert(!stopping);
+      tasks.push(std::move(task));
+      ++num_active;
+    }
+    task_cv.notify_one();
+  }
+
+  /// Block until every queued task has finished.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this]() { return num_active == 0; });
+  }
+
+  /// Call fun(i) for every i in [0, count) across the pool; returns once all calls finish.
+  template <typename FUN_T>
+  void ParallelFor(size_t count, FUN_T && fun) {
+    for (size_t i = 0; i < count; ++i) Run([&fun, i]() { fun(i); });
+    Wait();
+  }
+};
+
+}
+
+#endif